@@ -24,14 +24,44 @@ int main(int argc, char* argv[]){
   
   std::string function = argv[1];
   if(function.compare("test") == 0){ // test BDD
-    if(argc != 4){
+    if(argc < 4 || argc > 8){
       std::cerr << "Test: Bad arguments!" << std::endl;
       return EXIT_FAILURE;
     }
     char* bddName = argv[2];
     k = atoi(argv[3]);
-    im_leave_one_out(bddName, 
-		     k);
+    IMleaveOneOutOptions options;
+    bool depthGiven = false;
+    for(int i=4 ; i<argc ; i++){
+      std::string option(argv[i]);
+      if(option.compare("warm") == 0)
+	options.warmStart = true;
+      else if(option.compare("onepass") == 0)
+	options.singlePass = true;
+      else if(option.compare("parallel") == 0)
+	options.parallel = true;
+      else if(!depthGiven &&
+	      option.find_first_not_of("0123456789") == std::string::npos){
+	options.treeDepth = atoi(argv[i]);
+	depthGiven = true;
+      }
+      else{
+	std::cerr << "Test: unknown argument " << option << "!" << std::endl;
+	help();
+	return EXIT_FAILURE;
+      }
+    }
+    im_leave_one_out(bddName, k, options);
+  }
+  else if(function.compare("sweep") == 0){ // compare several k
+    if(argc < 4){
+      std::cerr << "Sweep: Bad arguments!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::vector<int> ks;
+    for(int i=3 ; i<argc ; i++)
+      ks.push_back(atoi(argv[i]));
+    im_k_sweep(argv[2], ks);
   }
   else if(function.compare("refresh") == 0){ // delete all files but not videos and recompute stips
     if(argc == 5){
@@ -92,13 +122,49 @@ int main(int argc, char* argv[]){
     }
   }
   else if(function.compare("compute") == 0){ // in order to add video + stips in db
-    if(argc != 4){
+    if(argc != 4 && argc != 5){
       std::cerr << "compute: bad arguments!" << std::endl;
       return EXIT_FAILURE;
     }
     char* bddName = argv[2];
     k = atoi(argv[3]);
-    im_train_bdd(bddName, k);
+    int treeDepth = (argc == 5) ? atoi(argv[4]) : 0;
+    im_train_bdd(bddName, k, treeDepth);
+  }
+  else if(function.compare("pca") == 0){
+    if(argc != 4){
+      std::cerr << "pca: bad arguments!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    im_set_pca(argv[2], atoi(argv[3]));
+  }
+  else if(function.compare("coreset") == 0){
+    if(argc != 4){
+      std::cerr << "coreset: bad arguments!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    im_set_coreset(argv[2], atoi(argv[3]));
+  }
+  else if(function.compare("reservoir") == 0){
+    if(argc != 4){
+      std::cerr << "reservoir: bad arguments!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    im_set_reservoir(argv[2], atoi(argv[3]));
+  }
+  else if(function.compare("linear") == 0){
+    if(argc != 4){
+      std::cerr << "linear: bad arguments!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    im_set_linear(argv[2], atoi(argv[3]));
+  }
+  else if(function.compare("approx") == 0){
+    if(argc != 4){
+      std::cerr << "approx: bad arguments!" << std::endl;
+      return EXIT_FAILURE;
+    }
+    im_set_approximation(argv[2], atoi(argv[3]) != 0);
   }
   else if(function.compare("delete") == 0){ 
     std::string todelete(argv[2]);
@@ -150,6 +216,14 @@ void help(){
 
   std::cout << "Effectuer les algorithmes d'apprentissage :" << std::endl;
   std::cout << "\t ./naomngt compute <bdd_name> <nr_centers>" << std::endl;
+  std::cout << "\t ./naomngt compute <bdd_name> <branching> <depth> (arbre de vocabulaire: branching^depth mots)" << std::endl;
+  std::cout << "\t ./naomngt test <bdd_name> <nr_centers> [<depth>] [warm] [onepass] [parallel] (leave-one-person-out, warm: codebooks des plis affinés depuis celui de tous, onepass: descripteurs lus une seule fois pour tous les plis, parallel: plis exécutés en parallèle, chacun dans son dossier fold_<personne>)" << std::endl;
+  std::cout << "\t ./naomngt sweep <bdd_name> <nr_centers_1> ... <nr_centers_n> (leave-one-person-out pour chaque nombre de centres, codebooks obtenus par divisions successives, tableau exporté dans k_sweep.txt)" << std::endl;
+  std::cout << "\t ./naomngt pca <bdd_name> <dim> (projection des descripteurs avant le k-means, 0 pour la désactiver)" << std::endl;
+  std::cout << "\t ./naomngt coreset <bdd_name> <size> (k-means sur un coreset pondéré de chaque activité, 0 pour le désactiver)" << std::endl;
+  std::cout << "\t ./naomngt reservoir <bdd_name> <size> (k-means sur un échantillon uniforme de chaque activité, 0 pour maxPts par fichier)" << std::endl;
+  std::cout << "\t ./naomngt linear <bdd_name> <order> (modèles linéaires sur l'approximation d'ordre <order> du noyau, plus rapides à prédire, 0 pour les SVMs à noyau)" << std::endl;
+  std::cout << "\t ./naomngt approx <bdd_name> <0|1> (1: reconnaissance avec l'approximation linéaire des SVMs à noyau CHIS/INTERS, plus rapide mais moins précise, 0: SVMs exacts, par défaut)" << std::endl;
   
   std::cout << "Suppression de BDD / activités :" << std::endl;
   std::cout << "\t ./naomngt delete activity <activity_name> <bdd_name>" << std::endl;
@@ -28,6 +28,17 @@ class IMbdd{
   int k;
   std::string KMeansFile;
   
+  // PCA (pcaDim = 0: no PCA)
+  int pcaDim;
+  std::string pcaFile;
+  
+  // Coreset (coresetSize = 0: the k-means runs on the imported descriptors)
+  int coresetSize;
+  
+  // Reservoir (reservoirSize = 0: the descriptors of each file are
+  // imported up to maxPts)
+  int reservoirSize;
+  
   // Normalization
   std::string normalization;
   std::string meansFile;
@@ -37,6 +48,13 @@ class IMbdd{
   int nr_class;
   std::vector<std::string> modelFiles;
   
+  // Linear models (mapOrder = 0: kernel SVMs, mapOrder > 0: linear models
+  // trained on the feature map of this order of the kernel)
+  int mapOrder;
+  // The CHIS and INTERS kernel models are also exported as (approximate)
+  // linear models, which the recognition uses
+  bool approxPrediction;
+  
  public:
   IMbdd(std::string bddName, std::string folder);
   ~IMbdd(){};
@@ -58,11 +76,19 @@ class IMbdd{
   int getDim() const {return dim;};
   int getMaxPts() const {return maxPts;};
   std::string getKMeansFile() const {return KMeansFile;};
+  int getPCADim() const {return pcaDim;};
+  std::string getPCAFile() const {return pcaFile;};
+  int getCoresetSize() const {return coresetSize;};
+  int getReservoirSize() const {return reservoirSize;};
+  // The dimension of the descriptors once projected (the codebook's one)
+  int getCodebookDim() const {return (pcaDim > 0) ? pcaDim : dim;};
   std::string getNormalization() const {return normalization;};
   std::string getMeansFile() const {return meansFile;};
   std::string getStandardDeviationFile() const {return standardDeviationFile;};
   int getNrClass() const {return nr_class;};
   std::vector<std::string> getModelFiles() const {return modelFiles;};
+  int getMapOrder() const {return mapOrder;};
+  bool getApproxPrediction() const {return approxPrediction;};
   void changeDataSettings(std::vector<std::string> activities,
 				 std::vector<std::string> people,
 				 std::string reject);
@@ -72,11 +98,17 @@ class IMbdd{
   void changeKMSettings(std::string algorithm,
 			int k,
 			std::string KMeansFile);
+  void changePCASettings(int pcaDim,
+			 std::string pcaFile);
+  void changeCoresetSettings(int coresetSize);
+  void changeReservoirSettings(int reservoirSize);
   void changeNormalizationSettings(std::string normalization,
 				   std::string meansFile,
 				   std::string standardDeviationFile);  
   void changeSVMSettings(int nr_class,
 			 std::vector<std::string> modelFiles);
+  void changeLinearSettings(int mapOrder);
+  void changeApproxSettings(bool approxPrediction);
 };
 
 #endif // _IMBDD_H_
@@ -53,6 +53,28 @@ class KMfilterCenters;				// see KMfilterCenters.h
 class KCnode;
 typedef KCnode	*KCptr;			// pointer to kc-node
 
+//----------------------------------------------------------------------
+//  KCcontext - state shared by one traversal of the tree
+//	The points, the centers and the sums being accumulated are
+//	needed all along the recursive traversals.  Rather than keeping
+//	them in globals, they are gathered here and passed down the
+//	recursion, so that several trees (with several sets of centers)
+//	can be traversed at the same time from different threads.
+//----------------------------------------------------------------------
+
+struct KCcontext {
+    int			dim;		// dimension of space
+    int			dataSize;	// number of data points
+    KMdataArray		points;		// data points
+    int			kCtrs;		// number of centers
+    int*		weights;	// weights of each center
+    KMpointArray	centers;	// the center points
+    KMpointArray	sums;		// sums
+    double*		sumSqs;		// sum of squares
+    double*		dists;		// distortions
+    KMpoint		boxMidpt;	// bounding-box midpoint
+};
+
 class KCtree {
 protected:
     int			dim;		// dimension of space
@@ -149,30 +171,33 @@ public:
     	
     virtual ~KCnode();		// destructor
 
-    void cellMidpt(KMpoint pt);		// get cell's midpoint (pt modified)
+    void cellMidpt(int dim, KMpoint pt);	// get cell's midpoint (pt modified)
 
     KMorthRect &bndBox()		// get cell's bounding box
     {  return bnd_box;  }
 
     virtual void makeSums(		// compute sums of points
+	KCcontext	&ctx,			// traversal state
 	int		&n,			// number of points (returned)
 	KMpoint		&theSum,		// sum (returned)
 	double		&theSumSq) = 0;		// sum of squares (returned)
 
     virtual void getNeighbors(		// compute neighbors for centers
+	KCcontext	&ctx,			// traversal state
 	KMctrIdxArray	cands,			// candidate centers
 	int		kCands) = 0;		// number of centers
 
     virtual void getAssignments(	// get assignments for leaf node
+	KCcontext	&ctx,			// traversal state
 	KMctrIdxArray	cands,			// candidate centers
 	int		kCands,			// number of centers
 	KMctrIdxArray 	closeCtr,		// closest center per point
 	double*	 	sqDist) = 0;		// sq'd distance to center
 
 					// sample a center point c
-    virtual void sampleCtr(KMpoint c, KMorthRect& bb) = 0;
+    virtual void sampleCtr(KCcontext& ctx, KMpoint c, KMorthRect& bb) = 0;
 						//
-    virtual void print(int level) = 0;	// print node
+    virtual void print(KCcontext& ctx, int level) = 0;	// print node
 
     int n_nodes()			// number of nodes in this subtree
     { return 2*n_data - 1; }			// this assumes bucket size=1!
@@ -204,28 +229,31 @@ public:
     	
     virtual ~KCleaf() {}		// destructor (none)
 
-    KMpoint getPoint();			// get data point
+    KMpoint getPoint(KCcontext& ctx);	// get data point
 
     virtual void makeSums(		// compute sums
+	KCcontext	&ctx,			// traversal state
 	int		&n,			// number of points (returned)
 	KMpoint		&theSum,		// sum (returned)
 	double		&theSumSq);		// sum of squares (returned)
 
     virtual void getNeighbors(		// compute neighbors for centers
+	KCcontext	&ctx,			// traversal state
 	KMctrIdxArray	cands,			// candidate centers
 	int		kCands);		// number of centers
 
     virtual void getAssignments(	// get assignments for leaf node
+	KCcontext	&ctx,			// traversal state
 	KMctrIdxArray	cands,			// candidate centers
 	int		kCands,			// number of centers
 	KMctrIdxArray 	closeCtr,		// closest center per point
 	double*	 	sqDist);		// sq'd distance to center
 
 					// sample a center point c
-    virtual void sampleCtr(KMpoint c, KMorthRect& bb);
+    virtual void sampleCtr(KCcontext& ctx, KMpoint c, KMorthRect& bb);
 
 					// print node
-    virtual void print(int level);
+    virtual void print(KCcontext& ctx, int level);
 };
 
 //----------------------------------------------------------------------
@@ -272,25 +300,28 @@ public:
 	}
 
     virtual void makeSums(	// compute sums
+	KCcontext	&ctx,			// traversal state
 	int		&n,			// number of points (returned)
 	KMpoint		&theSum,		// sum (returned)
 	double		&theSumSq);		// sum of squares (returned)
 
     virtual void getNeighbors(		// compute neighbors for centers
+	KCcontext	&ctx,			// traversal state
 	KMctrIdxArray	cands,			// candidate centers
 	int		kCands);		// number of centers
 
     virtual void getAssignments(	// get assignments for leaf node
+	KCcontext	&ctx,			// traversal state
 	KMctrIdxArray	cands,			// candidate centers
 	int		kCands,			// number of centers
 	KMctrIdxArray 	closeCtr,		// closest center per point
 	double*	 	sqDist);		// sq'd distance to center
 
 					// sample a center point c
-    virtual void sampleCtr(KMpoint c, KMorthRect& bb);
+    virtual void sampleCtr(KCcontext& ctx, KMpoint c, KMorthRect& bb);
 
 					// print node
-    virtual void print(int level);
+    virtual void print(KCcontext& ctx, int level);
 };
 
 //----------------------------------------------------------------------
@@ -44,6 +44,12 @@
 // 	assignments.  If you want to resuse the structure, the only way
 // 	to do so is to first apply resize(), which destroys the kc-tree
 // 	(if it exists), and then assign to it a new set of points.
+//
+//	A subset view can be built from an existing point set and an
+//	array of point indices.  The view does not copy coordinates: it
+//	only holds a table of row pointers into the storage of the base
+//	set, which must outlive the view.  Its kc-tree is built over the
+//	selected rows only.
 //----------------------------------------------------------------------
 
 class KMdata {
@@ -53,6 +59,7 @@ private:
     int			nPts;		// number of data points
     KMdataArray		pts;		// the data points
     KCtree*		kcTree;		// kc-tree for the points
+    bool		ownPts;		// do we own the coordinates?
 private:				// copy functions (not implemented)
     KMdata(const KMdata& p)		// copy constructor
       { assert(false); }
@@ -60,6 +67,14 @@ private:				// copy functions (not implemented)
       { assert(false);  return *this; }
 public:
     KMdata(int d, int n);		// standard constructor
+    KMdata(				// subset view (no copy)
+	const KMdata&	base,			// the full point set
+	KMdatIdxArray	idx,			// indices of the subset
+	int		n);			// number of indices
+    KMdata(				// range view (no copy)
+	const KMdata&	base,			// the full point set
+	int		first,			// index of the first point
+	int		n);			// number of points
 
     int getDim() const {		// get dimension
 	return dim;
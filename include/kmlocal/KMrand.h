@@ -28,10 +28,24 @@
 #include <math.h>			// math routines
 #include "KMeans.h"			// KMeans includes
 
+//----------------------------------------------------------------------
+//  Thread-local storage
+//	The state of the random generator is kept per thread, so that
+//	several k-means runs (several KMfilterCenters) can proceed at
+//	the same time, each with its own reproducible sequence.
+//----------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define KM_THREAD __declspec(thread)
+#else
+#define KM_THREAD __thread
+#endif
+
 //----------------------------------------------------------------------
 //  Globals
+//	Setting kmIdum to a negative value (re)seeds the generator of
+//	the calling thread.
 //----------------------------------------------------------------------
-extern	int	kmIdum;			// used for random number generation
+extern	KM_THREAD int	kmIdum;		// used for random number generation
 
 //----------------------------------------------------------------------
 //  External entry points
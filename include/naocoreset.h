@@ -0,0 +1,143 @@
+/** @author agent
+ *  @file naocoreset.h
+ *  @date 19/10/2026
+ *  Summaries of the descriptors of an activity for the k-means, built in
+ *  one pass over the files: weighted coresets (streaming merge-and-reduce
+ *  with sensitivity sampling) and uniform samples (reservoir sampling).
+ */
+#ifndef _NAOCORESET_H_
+#define _NAOCORESET_H_
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "KMlocal.h"			// k-means algorithms
+
+// Default number of weighted points of a coreset
+#define KM_CORESET_SIZE 20000
+// Maximum number of seeds of the bicriteria solution used by the reduction
+#define KM_CORESET_MAX_SEEDS 64
+
+void kmWeightedSeeding(const KMdata& dataPts, const double* weights, int k,
+		       KMpointArray ctrs, KMctrIdxArray closeCtr = NULL,
+		       double* sqDist = NULL);
+
+/**
+ * \class KMsummary
+ * \brief What kmStreamSTIPs needs: a summary to which the descriptors of
+ * a stream are added block after block.
+ */
+class KMsummary{
+ public:
+  virtual ~KMsummary(){}
+  virtual void add(const KMdata& dataPts) = 0;
+};
+
+/**
+ * \class KMcoreset
+ * \brief A weighted summary of a stream of descriptors: the k-means cost
+ * of any set of centers over the coreset approximates (with high
+ * probability) their cost over all the descriptors of the stream.
+ *
+ * The descriptors are added by blocks (add). Every time size descriptors
+ * are buffered they become a bucket of level 0; two buckets of the same
+ * level are merged and reduced to size weighted points, which is a bucket
+ * of the next level (merge-and-reduce, like a binary counter). So a stream
+ * of N descriptors needs O(size.log(N/size)) points of memory and each
+ * descriptor goes through O(log(N/size)) reductions.
+ *
+ * A reduction is a sensitivity sampling (Bachem, Lucic and Krause,
+ * "Practical coreset constructions for machine learning"): a weighted
+ * k-means++ seeding gives a bicriteria solution B, the sensitivity of a
+ * point is bounded with its distance to B and the cost of its cluster,
+ * and size points are drawn proportionally to it with weights correcting
+ * the sampling probability. Unlike a uniform sample, the small clusters
+ * and the far points are kept.
+ *
+ * finish() reduces the remaining buckets to the final coreset. A coreset
+ * can also be added to another one (add(const KMcoreset&)), so that the
+ * coresets of several files can be built concurrently and merged.
+ * The random numbers come from the generator of the calling thread.
+ */
+class KMcoreset : public KMsummary{
+ public:
+  KMcoreset(int dim, int size = KM_CORESET_SIZE, int nrSeeds = KM_CORESET_MAX_SEEDS);
+  ~KMcoreset();
+
+  int getDim() const { return dim; }
+  int getSize() const { return size; }
+  double getNrDescriptors() const { return nrDescriptors; }
+  virtual void add(const KMdata& dataPts);
+  void add(const KMcoreset& coreset);
+  void finish();
+
+  // The coreset (once finished)
+  int getNPts() const { return nPts; }
+  KMdata& getPts() { return *pts; }
+  const KMdata& getPts() const { return *pts; }
+  const double* getWeights() const { return weights; }
+ private:
+  KMcoreset(const KMcoreset&);
+  KMcoreset& operator=(const KMcoreset&);
+
+  // A set of weighted points: x holds n*dim coordinates
+  struct KMbucket{
+    std::vector<double> x;
+    std::vector<double> w;
+    int n() const { return w.size(); }
+    void clear(){ x.clear(); w.clear(); }
+  };
+  void push(const double* x, double w);
+  void carry(KMbucket& bucket);
+  void reduce(KMbucket& bucket) const;
+
+  int dim;
+  int size;
+  int nrSeeds;
+  double nrDescriptors; // total weight added
+  KMbucket buffer;
+  std::vector<KMbucket> levels;
+
+  int nPts;
+  KMdata* pts;
+  double* weights;
+};
+
+/**
+ * \class KMreservoir
+ * \brief A uniform sample (without replacement) of at most size
+ * descriptors of a stream, whatever its length (reservoir sampling,
+ * Vitter's algorithm R): the i-th descriptor replaces a random one of the
+ * sample with probability size/i.
+ *
+ * Two reservoirs of disjoint streams are merged into a uniform sample of
+ * the union (add(const KMreservoir&)), so that the files can be sampled
+ * concurrently. The memory is size descriptors. The random numbers come
+ * from the generator of the calling thread.
+ */
+class KMreservoir : public KMsummary{
+ public:
+  KMreservoir(int dim, int size);
+  ~KMreservoir();
+
+  int getDim() const { return dim; }
+  int getSize() const { return size; }
+  double getNrDescriptors() const { return nrDescriptors; }
+  virtual void add(const KMdata& dataPts);
+  void add(const KMreservoir& reservoir);
+
+  // The sample
+  int getNPts() const { return pts->getNPts(); }
+  KMdata& getPts() { return *pts; }
+  const KMdata& getPts() const { return *pts; }
+ private:
+  KMreservoir(const KMreservoir&);
+  KMreservoir& operator=(const KMreservoir&);
+
+  int dim;
+  int size;
+  double nrDescriptors; // number of descriptors of the stream
+  KMdata* pts;
+};
+
+#endif
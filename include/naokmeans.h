@@ -10,15 +10,29 @@
 #include <string.h>			// C++ strings
 #include <fstream>
 #include "KMlocal.h"			// k-means algorithms
+#include "naoquantizer.h"		// nearest center search
+#include "naocoreset.h"		// coresets and reservoirs
 #include "naomngt.h"
 
 using namespace std;		
 
-int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts);
+// Number of descriptors read at a time by kmStreamSTIPs
+#define KM_STREAM_BLOCK 4096
+
+int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts, int first = 0);
+int countSTIPs(std::string stip, int maxPts);
 void exportSTIPs(std::string stip, int dim, const KMdata& dataPts);
 void importCenters(std::string centers, int dim, int k, KMfilterCenters* ctrs);
 void exportCenters(std::string centers, int dim, int k, KMfilterCenters ctrs);
-void kmIvanAlgorithm(int ic, int dim,  const KMdata& dataPts, int k, KMfilterCenters& ctrs);
+void exportCenters(std::string centers, int dim, int k, const KMpointArray ctrs);
+void kmSampleIndices(int nPts, int sampleSize, int* indices);
+double kmLloydStage(const KMdata& dataPts, KMcenters& ctrs, const double* weights = NULL);
+void kmIvanAlgorithm(int ic, int dim, KMdata& dataPts, int k, KMcenters& ctrs);
+void kmWeightedAlgorithm(int ic, KMdata& dataPts, const double* weights, int k, KMcenters& ctrs);
+void kmSplitCenters(int ic, const KMdata& dataPts, const double* weights,
+		    const KMcenters& from, KMcenters& to);
+int kmStreamSTIPs(std::string stip, int dim, KMsummary& summary);
+void kmVocabularyTree(int ic, KMdata& dataPts, KMvocabularyTree& tree);
 void createTrainingMeans(std::string stipFile,
 			 int dim,
 			 int maxPts,
@@ -19,17 +19,55 @@
 #include <utility> // make_pair
 #include <map>
 #include <algorithm> // tri dans l'odre croissant
+#include <time.h> // seeds of the k-means
+#include <omp.h> // omp_get_wtime
 
 #include <ftplib.h> // ftp transfer
 
 #include "naokmeans.h"
+#include "naopca.h"
 #include "naosvm.h"
 #include "naodensetrack.h"
 #include "imconfig.h"
 #include "imbdd.h"
 
+// Number of Lloyd's stages refining a warm-started codebook
+#define IM_WARM_STAGES 2
+// Successive halving of the (C, gamma) search: only the best 1/ETA
+// candidates of a rung go on to the next one, which has ETA times more
+// folds (at least MIN_FOLDS). ETA = 1 scores the whole grid on all the folds.
+#define IM_HALVING_ETA 3
+#define IM_HALVING_MIN_FOLDS 2
+
 using namespace std;
 
+/**
+ * \class IMleaveOneOutOptions
+ * \brief The options of the leave-one-person-out (see im_leave_one_out).
+ */
+class IMleaveOneOutOptions{
+ public:
+  // The depth of the vocabulary tree (0: no tree)
+  int treeDepth;
+  // If true (specifical codebook only), a codebook is first trained on all
+  // the people and the codebook of each fold is only refined from it
+  // (IM_WARM_STAGES Lloyd's stages on the fold's training people) instead
+  // of being trained from scratch
+  bool warmStart;
+  // If true, the codebooks of all the folds are built first, then the
+  // descriptors are read once and quantized with all of them (see
+  // im_compute_bdd_bows) instead of being read again for each fold
+  bool singlePass;
+  // If true, the folds run concurrently (each one with its descriptors in
+  // memory), each one saving its files in its own folder (see
+  // im_set_fold_folder, deleted once the fold is done). The results are reduced in the order of the
+  // folds, as in the serial run.
+  bool parallel;
+  
+  IMleaveOneOutOptions() :
+    treeDepth(0), warmStart(false), singlePass(false), parallel(false){};
+};
+
 int nbOfFiles(std::string path);
 bool fileExist(std::string file, std::string folder);
 
@@ -65,11 +103,29 @@ void im_concatenate_bdd_feature_points(std::string path2bdd,
 void im_concatenate_folder_feature_points(std::string folder,
 					  std::vector<std::string> activities);
 int im_create_specifics_training_means(IMbdd bdd,
-				       const std::vector<std::string>& trainingPeople 
+				       const std::vector<std::string>& trainingPeople,
 				       //std::vector <std::string> rejects
-				       );
-void im_leave_one_out(std::string bddName, 
-		      int k);
+				       const KMpointArray initCtrs = NULL);
+KMdata* im_import_training_pool(const IMbdd& bdd,
+				const std::vector<std::string>& trainingPeople,
+				int* actIndex);
+void im_build_training_coresets(const IMbdd& bdd,
+				const std::vector<std::string>& trainingPeople,
+				int nrSeeds,
+				KMcoreset** coresets);
+int im_create_vocabulary_tree(const IMbdd& bdd,
+			      const std::vector<std::string>& trainingPeople,
+			      int b, int L);
+KMcodebook* im_load_codebook(const IMbdd& bdd);
+KMpca* im_load_pca(const IMbdd& bdd);
+void im_set_pca(std::string bddName, int pcaDim);
+void im_set_coreset(std::string bddName, int size);
+void im_set_reservoir(std::string bddName, int size);
+void im_set_linear(std::string bddName, int order);
+void im_set_approximation(std::string bddName, bool approximate);
+void im_leave_one_out(std::string bddName, int k,
+		      const IMleaveOneOutOptions& options = IMleaveOneOutOptions());
+void im_k_sweep(std::string bddName, std::vector<int> ks);
 double im_training_leave_one_out(const IMbdd& bdd,
 				 const std::vector<std::string>& trainingPeople,
 				 const std::map <std::string, struct svm_problem>& peopleBOW,
@@ -81,10 +137,22 @@ double im_svm_train(IMbdd& bdd,
 		    MatrixC& trainMC,
 		    const std::vector<std::string>& testingPeople,
 		    MatrixC& testMC);
+double im_svm_train(IMbdd& bdd,
+		    const std::vector<std::string>& trainingPeople,
+		    MatrixC& trainMC,
+		    const std::vector<std::string>& testingPeople,
+		    MatrixC& testMC,
+		    std::map<std::string, struct svm_problem>& peopleBOW,
+		    int* modelSize = NULL);
 
-void im_train_bdd(std::string bddName, int k);
+void im_train_bdd(std::string bddName, int k, int treeDepth = 0);
 void im_compute_bdd_bow(const IMbdd& bdd, 
 			std::map <std::string, struct svm_problem>& peopleBOW);
+void im_compute_bdd_bows(const IMbdd& bdd,
+			 const std::vector<KMcodebook*>& codebooks,
+			 const std::vector<KMpca*>& pcas,
+			 std::vector<std::map<std::string, struct svm_problem> >& peopleBOWs,
+			 double* quantTimes = NULL);
 void im_normalize_bdd_bow(const IMbdd& bdd,
 			  const std::vector<std::string>& trainingPeople,
 			  std::map<std::string, struct svm_problem>& peopleBOW);
@@ -93,4 +161,8 @@ void im_fill_confusion_matrix(const IMbdd& bdd,
 			      const svm_problem& svmProblem,
 			      struct svm_model** svmModels,
 			      MatrixC& MC);
+void im_fill_confusion_matrix(const IMbdd& bdd,
+			      const svm_problem& svmProblem,
+			      LinearOvrPredictor& predictor,
+			      MatrixC& MC);
 #endif
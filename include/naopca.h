@@ -0,0 +1,52 @@
+/** @author agent
+ *  @file naopca.h
+ *  @date 19/10/2026
+ *  Principal component analysis of the descriptors (dimension reduction
+ *  ahead of the k-means and of the quantization).
+ */
+#ifndef _NAOPCA_H_
+#define _NAOPCA_H_
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "KMlocal.h"			// k-means algorithms
+
+// Maximum number of descriptors used to fit the PCA
+#define KM_PCA_MAX_SAMPLE 50000
+
+/**
+ * \class KMpca
+ * \brief Projection of the descriptors on their outDim first principal
+ * components: y = W'(x - mean).
+ *
+ * W is stored dim x outDim so that the projection of one descriptor runs
+ * over consecutive output values (it is vectorized by the compiler).
+ */
+class KMpca{
+ public:
+  KMpca(const KMdata& sample, int outDim, const double* weights = NULL);
+  KMpca(std::string file);
+  ~KMpca();
+
+  int getInDim() const { return inDim; }
+  int getOutDim() const { return outDim; }
+  double getExplainedVariance() const;
+  void exportPCA(std::string file) const;
+
+  void project(const double* x, double* y) const;
+  void project(const KMdata& in, KMdata& out) const;
+  void backProject(const double* y, double* x) const;
+ private:
+  KMpca(const KMpca&);
+  KMpca& operator=(const KMpca&);
+
+  int inDim;
+  int outDim;
+  double* mean; // inDim
+  double* W; // inDim x outDim (W[d*outDim + r])
+  double* eigenvalues; // inDim (decreasing order)
+};
+
+void kmSymmetricEigen(int n, double* A, double* eigenvalues, double* V);
+
+#endif
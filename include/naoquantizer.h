@@ -0,0 +1,163 @@
+/** @author agent
+ *  @file naoquantizer.h
+ *  @date 19/10/2026
+ *  Nearest center search over a fixed codebook (training.means).
+ */
+#ifndef _NAOQUANTIZER_H_
+#define _NAOQUANTIZER_H_
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "KMlocal.h"			// k-means algorithms
+
+// Under this dimension and from this number of centers the centers are
+// put in a kd-tree, otherwise they are scanned (brute force).
+#define KM_QUANTIZER_TREE_MAX_DIM 16
+#define KM_QUANTIZER_TREE_MIN_K 64
+
+// Blocks of the batched kernel: KM_BLOCK_PTS descriptors are compared to
+// KM_BLOCK_CTRS centers at a time (both blocks stay in the L2 cache).
+#define KM_BLOCK_PTS 64
+#define KM_BLOCK_CTRS 32
+// The transposed centers are padded to a multiple of KM_SIMD_CTRS (the
+// widest SIMD register) with centers of norm KM_PAD_NORM.
+#define KM_SIMD_CTRS 8
+#define KM_PAD_NORM 1e30
+
+inline int kmPadCtrs(int k){
+  return (k + KM_SIMD_CTRS - 1)/KM_SIMD_CTRS*KM_SIMD_CTRS;
+}
+
+void kmNearestCenters(const KMpointArray pts, int n, int dim,
+		      const double* ctrsT, const double* ctrNorms, int k,
+		      KMctrIdxArray closeCtr, double* sqDist);
+void kmNearestCenters(const KMpointArray pts, int n, int dim,
+		      const float* ctrsT, const float* ctrNorms, int k,
+		      KMctrIdxArray closeCtr, double* sqDist);
+void kmNearestCentersPDE(const KMpointArray pts, int n, int dim,
+			 const double* ctrs, int k,
+			 KMctrIdxArray closeCtr, double* sqDist);
+void kmNearestCentersPDE(const KMpointArray pts, int n, int dim,
+			 const float* ctrs, int k,
+			 KMctrIdxArray closeCtr, double* sqDist);
+
+/**
+ * \class KMcodebook
+ * \brief What computeBOW needs to quantize descriptors: k words of
+ * dimension dim and the assignment of descriptors to the words.
+ */
+class KMcodebook{
+ public:
+  virtual ~KMcodebook(){}
+  virtual int getDim() const = 0;
+  virtual int getK() const = 0;
+  virtual void getAssignments(const KMdata& dataPts,
+			      KMctrIdxArray closeCtr,
+			      double* sqDist = NULL) const = 0;
+};
+
+/**
+ * \class KMquantizer
+ * \brief The codebook used to quantize descriptors.
+ *
+ * It is built once from the centers and is then reused for every video:
+ * assigning N descriptors does not build anything over the descriptors.
+ * The centers are stored contiguously with their squared norms so that
+ * ||x-c||^2 = ||x||^2 - 2x.c + ||c||^2 is a dot product per center; for
+ * small dimensions and many centers a kd-tree over the centers is used.
+ * Otherwise the descriptors are assigned by blocks with kmNearestCenters
+ * (in double or, optionally, in single precision), or one by one with a
+ * partial distance early exit (kmNearestCentersPDE) when asked.
+ * The object is read-only after its construction (thread safe).
+ */
+class KMquantizer : public KMcodebook{
+ public:
+  KMquantizer(int dim, int k, const KMpointArray ctrs);
+  KMquantizer(std::string centers, int dim, int k);
+  ~KMquantizer();
+
+  virtual int getDim() const { return dim; }
+  virtual int getK() const { return k; }
+  bool usesTree() const { return root >= 0; }
+  const double* getCenter(int c) const { return ctrs + c*dim; }
+  void setSinglePrecision(bool single);
+  void setEarlyExit(bool earlyExit){ this->earlyExit = earlyExit; }
+
+  int nearest(const double* x, double* sqDist = NULL) const;
+  virtual void getAssignments(const KMdata& dataPts,
+			      KMctrIdxArray closeCtr,
+			      double* sqDist = NULL) const;
+ private:
+  KMquantizer(const KMquantizer&);
+  KMquantizer& operator=(const KMquantizer&);
+  void init(const KMpointArray ctrs);
+  int nearestBruteForce(const double* x, double& best) const;
+
+  // kd-tree over the centers
+  int buildTree(int first, int last);
+  void searchTree(int node, const double* x, int& bestCtr, double& best) const;
+
+  int dim;
+  int k;
+  double* ctrs; // k x dim, row-major
+  double* ctrNorms; // ||c||^2 (padded)
+  double* ctrsT; // dim x kmPadCtrs(k) (transposed for the batched kernel)
+  float* ctrsF; // the same in single precision (NULL if not used)
+  float* ctrNormsF; // padded
+  float* ctrsTF;
+  bool earlyExit;
+
+  int root; // -1 when the centers are scanned
+  int nrNodes;
+  int* ctrIdx; // permutation of the centers (leaves are ranges of it)
+  int* cutDim; // -1 for a leaf
+  double* cutVal;
+  int* loChild; // or first center of a leaf
+  int* hiChild; // or last center (excluded) of a leaf
+};
+
+/**
+ * \class KMvocabularyTree
+ * \brief Hierarchical k-means codebook (Nister and Stewenius): a complete
+ * tree of branching factor b and depth L whose b^L leaves are the words.
+ *
+ * The nodes are numbered level by level (the root is 0, the children of
+ * the node n are n*b+1 ... n*b+b) and every node but the root has a
+ * center. A descriptor goes down the tree to the closest child at each
+ * level: its word is found in O(b.L.dim) instead of O(b^L.dim).
+ */
+class KMvocabularyTree : public KMcodebook{
+ public:
+  KMvocabularyTree(int dim, int b, int L);
+  KMvocabularyTree(std::string file);
+  ~KMvocabularyTree();
+
+  virtual int getDim() const { return dim; }
+  virtual int getK() const { return nrLeaves; }
+  int getBranching() const { return b; }
+  int getDepth() const { return L; }
+  int getNrNodes() const { return nrNodes; }
+  double* getCenter(int node) { return ctrs + node*dim; }
+  void updateNorms();
+  void exportTree(std::string file) const;
+
+  int leaf(const double* x, double* sqDist = NULL) const;
+  virtual void getAssignments(const KMdata& dataPts,
+			      KMctrIdxArray closeCtr,
+			      double* sqDist = NULL) const;
+ private:
+  KMvocabularyTree(const KMvocabularyTree&);
+  KMvocabularyTree& operator=(const KMvocabularyTree&);
+  void allocate();
+
+  int dim;
+  int b; // branching factor
+  int L; // depth
+  int nrNodes;
+  int nrLeaves; // b^L
+  int firstLeaf; // node number of the first leaf
+  double* ctrs; // nrNodes x dim (the root's center is not used)
+  double* ctrNorms; // ||c||^2
+};
+
+#endif
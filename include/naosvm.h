@@ -14,6 +14,7 @@
 #include <string>
 #include "svm.h"
 #include "KMlocal.h"
+#include "naoquantizer.h"
 #include "imbdd.h"
 
 using namespace std;
@@ -36,6 +37,9 @@ void printProblem(struct svm_problem svmProblem);
 //struct svm_node* importNodes(char* file);
 
 struct svm_problem computeBOW(int label, const KMdata& dataPts, KMfilterCenters& ctrs);
+struct svm_problem computeBOW(int label, const KMdata& dataPts,
+			      const KMcodebook& codebook);
+struct svm_problem computeBOW(int label, int k, int nPts, const KMctrIdxArray closeCtr);
 
 
 // Other
@@ -53,8 +57,33 @@ int svm_vote(int nrClass,
 	      );
 
 void destroy_svm_problem(struct svm_problem svmProblem);
-void addBOW(struct svm_node* bow, double label,
-	    struct svm_problem& svmProblem);
+struct svm_problem alloc_svm_problem(int l, size_t nrNodes, struct svm_node** nodes);
+
+/**
+ * \class SvmProblemBuilder
+ * \brief Builds an svm_problem stored in one block (CSR layout): the labels,
+ * the vectors x[i] and the nodes of all the vectors one after the other
+ * (each one ended by the index -1). The vectors are views of the nodes, so
+ * that libsvm uses the problem as usual, and destroy_svm_problem releases
+ * it with a single free.
+ *
+ * The BOWs are appended to the builder (amortized growth) and build()
+ * copies them into the block.
+ */
+class SvmProblemBuilder{
+ public:
+  SvmProblemBuilder(int l = 0, size_t nrNodes = 0);
+  
+  int getL() const { return y.size(); }
+  void addBOW(const struct svm_node* bow, double label);
+  void addBOW(const float* histogram, int k, double label);
+  void addProblem(const struct svm_problem& svmProblem);
+  struct svm_problem build() const;
+ private:
+  std::vector<struct svm_node> nodes; // with the -1 of each vector
+  std::vector<size_t> start; // the first node of each vector
+  std::vector<double> y;
+};
 
 //confusion matrix
 class MatrixC{
@@ -67,6 +96,7 @@ class MatrixC{
   void calculFrequence();
   int getIndex(double lab);
   void addTransfer(double lab_in,double lab_out);
+  void addMatrix(const MatrixC& mc);
   double** getMatrix();
  private:
   int** m;
@@ -105,8 +135,203 @@ struct svm_problem equalizeSVMProblem(const struct svm_problem& svmProblem,
 int get_svm_problem_labels(const struct svm_problem& svmProblem, int* labels);
 int getMaxIndex(const struct svm_problem& svmProblem);
 int getMinNumVideo(const struct svm_problem& svmProblem);
-svm_model **svm_train_ovr(const svm_problem *prob, svm_parameter *param);
+svm_model *svm_train_ovr_class(const svm_problem *prob, const svm_parameter *param,
+			       double label, double* alpha = NULL, double* G = NULL);
+svm_model **svm_train_ovr(const svm_problem *prob, const svm_parameter *param);
 double svm_predict_ovr_probs(struct svm_model** models, const svm_node* x, int nbr_class, double* probs,double lamda);
 void get_svm_parameter(int k, struct svm_parameter &svmParameter);
+
+/**
+ * \class OvrPredictor
+ * \brief The one-versus-the-rest models compiled for the prediction.
+ *
+ * The models are trained on the same BOWs, so their support vectors
+ * overlap: the predictor keeps each distinct SV once, evaluates the
+ * kernel between x and it once, and gets the decision values of all the
+ * classes by a product of the (nr_class x nr_sv) coefficient matrix and
+ * the kernel values. The SVs are not copied: the models (and the problem
+ * they were trained on) must live as long as the predictor.
+ *
+ * With the INTERS kernel the decision value is a sum over the bins d of
+ * h_d(x_d) = sum_j coef_j.min(x_d, sv_jd), which is piecewise linear in x_d
+ * (Maji, Berg and Malik, "Classification using intersection kernel
+ * support vector machines is efficient"). For each bin the nonzero values
+ * of the SVs are sorted with the prefix sums of coef_j.sv_jd and the
+ * suffix sums of coef_j: h_d(x_d) is one binary search away, so that a
+ * prediction is O(nnz(x).log(nr_sv)) instead of O(nr_sv.k).
+ *
+ * predictBatch predicts many BOWs concurrently without any allocation:
+ * each thread works in its own buffers, allocated with the predictor.
+ * predict and decisionValues work in the buffers of the first thread: the
+ * predictions modify the predictor (not const), which runs one of them at
+ * a time.
+ */
+class OvrPredictor{
+ public:
+  OvrPredictor(svm_model** models, int nr_class);
+  ~OvrPredictor();
+
+  int getNrClass() const { return nr_class; }
+  int getNrSV() const { return svs.l; }
+  double getLabel(int c) const { return labels[c]; }
+  void decisionValues(const svm_node* x, double* decvs);
+  double predict(const svm_node* x, double* probs, double lamda);
+  void predictBatch(const svm_node* const* x, int n, double* predicted,
+		    double* probs, double lamda);
+ private:
+  OvrPredictor(const OvrPredictor&);
+  OvrPredictor& operator=(const OvrPredictor&);
+  void buildIntersectionTables();
+  void decisionValues(const svm_node* x, double* decvs,
+		      double* kvalue, float* row) const;
+
+  int nr_class;
+  struct svm_model svs; // the distinct SVs (l, SV, param and dense rows)
+  double* coef;	// nr_class x svs.l, the sign making decv > 0 for the class
+  double* rho;
+  double* labels;
+
+  // INTERS tables (NULL for the other kernels or negative values)
+  int interDim; // largest index of the SVs
+  int* interStart; // the values of the bin d are interStart[d] to interStart[d+1]-1
+  double* interValues; // sorted nonzero values of the SVs in each bin
+  double* interLow; // sum of coef.sv_d over the values <= s (position x class)
+  double* interHigh; // sum of coef over the values > s (position x class)
+
+  // The buffers of predictBatch (nrBuffers threads): the kernel values,
+  // the dense row of x and the decision values and probabilities
+  int nrBuffers;
+  double* kvalueBuffers;
+  float* rowBuffers;
+  double* decvBuffers;
+};
+double svm_predict_ovr_probs(OvrPredictor& predictor, const svm_node* x,
+			     double* probs, double lamda);
+void svm_predict_ovr_batch(OvrPredictor& predictor, const svm_node* const* x,
+			   int n, double* predicted, double* probs, double lamda);
+
+// Length from which a kernel column is filled by several threads (svm_parameter.parallel_fill)
+#define SVM_PARALLEL_FILL 1024
+
+// Explicit feature maps of the CHIS and INTERS kernels: 2*order+1 features per bin
+#define SVM_MAP_ORDER 3
+// The mapped BOWs and the linear models are padded to a multiple of this number of floats
+#define SVM_MAP_WIDTH 8
+// Dual coordinate descent: stopping criteria (as LIBLINEAR) and maximum number of passes
+#define SVM_DCD_EPS 0.1
+#define SVM_DCD_MAX_ITER 1000
+
+/**
+ * \class AdditiveKernelMap
+ * \brief Explicit feature map of the CHIS or the INTERS kernel.
+ *
+ * Both kernels are additive and homogeneous: k(x,y) = sum_i
+ * sqrt(x_i.y_i).kappa(log(y_i/x_i)) with kappa the Fourier transform of
+ * their signature: sech(pi.l)/2 for CHIS, 2/(pi.(1+4l^2)) for INTERS.
+ * Sampling kappa with the period L gives a finite feature map psi of
+ * 2*order+1 features per bin (Vedaldi and Zisserman, "Efficient additive
+ * kernels via explicit feature maps") with k(x,y) ~ psi(x).psi(y).
+ */
+class AdditiveKernelMap{
+ public:
+  AdditiveKernelMap(int kernel_type, int k, int order = SVM_MAP_ORDER);
+  ~AdditiveKernelMap();
+
+  int getKernelType() const { return kernel_type; }
+  int getK() const { return k; }
+  int getOrder() const { return order; }
+  int getDim() const { return dim; }
+  void map(const svm_node* x, float* psi) const;
+  void map(const svm_node* const* x, int n, float* psi) const;
+ private:
+  AdditiveKernelMap(const AdditiveKernelMap&);
+  AdditiveKernelMap& operator=(const AdditiveKernelMap&);
+
+  int kernel_type;
+  int k;
+  int order;
+  int dim; // k*(2*order+1) padded
+  double period; // L
+  double* kappa; // L.kappa(j.L), j = 0..order (with the factor 2 for j > 0)
+};
+
+/**
+ * \class LinearOvrPredictor
+ * \brief One-versus-the-rest linear models over the feature map of the
+ * CHIS or the INTERS kernel: a prediction is psi(x) (computed once) and
+ * one dot product per class, whatever the number of SVs.
+ *
+ * The models are either converted from kernel models (the weight vector
+ * w = sum_j coef_j.psi(sv_j)) or trained on the mapped BOWs by dual
+ * coordinate descent (train, see svm_train_linear_ovr).
+ *
+ * As OvrPredictor, the predictions work in buffers of the predictor (one
+ * at a time).
+ */
+class LinearOvrPredictor{
+ public:
+  LinearOvrPredictor(svm_model** models, int nr_class, int k,
+		     int order = SVM_MAP_ORDER);
+  LinearOvrPredictor(int kernel_type, int k, int order,
+		     const std::vector<double>& labels);
+  LinearOvrPredictor(std::string file);
+  ~LinearOvrPredictor();
+  void exportModels(std::string file) const;
+  void train(const float* psi, const std::vector<int>& rows, const double* y,
+	     const struct svm_parameter& param, double* alpha);
+
+  const AdditiveKernelMap& getMap() const { return *kernelMap; }
+  int getNrClass() const { return nr_class; }
+  double getLabel(int c) const { return labels[c]; }
+  void decisionValues(const float* psi, double* decvs) const;
+  void decisionValues(const svm_node* x, double* decvs);
+  double predict(const float* psi, double* probs, double lamda);
+  double predict(const svm_node* x, double* probs, double lamda);
+  void predictBatch(const float* psi, int n, double* predicted,
+		    double* probs, double lamda);
+  void predictBatch(const svm_node* const* x, int n, double* predicted,
+		    double* probs, double lamda);
+ private:
+  LinearOvrPredictor(const LinearOvrPredictor&);
+  LinearOvrPredictor& operator=(const LinearOvrPredictor&);
+  void init(int kernel_type, int k, int order);
+
+  AdditiveKernelMap* kernelMap;
+  int nr_class;
+  int dim;
+  float* w; // nr_class x dim, the sign making decv > 0 for the class
+  double* rho;
+  double* labels;
+
+  // The buffers of predictBatch (nrBuffers threads): psi(x) and the
+  // decision values and probabilities
+  int nrBuffers;
+  float* psiBuffers;
+  double* decvBuffers;
+};
+double svm_predict_ovr_probs(LinearOvrPredictor& predictor, const svm_node* x,
+			     double* probs, double lamda);
+void svm_predict_ovr_batch(LinearOvrPredictor& predictor, const svm_node* const* x,
+			   int n, double* predicted, double* probs, double lamda);
+LinearOvrPredictor* svm_train_linear_ovr(const svm_problem *prob,
+					 const svm_parameter *param, int k,
+					 int order);
+void svm_compare_linear(OvrPredictor& exact,
+			LinearOvrPredictor& approx,
+			const struct svm_problem& svmProblem);
 std::vector<double> get_labels_from_prob(const svm_problem *prob);
+
+// Precomputed kernels (Gram matrices)
+bool svm_kernel_uses_gamma(int kernel_type);
+double svm_kernel_base(const svm_node* x, const svm_node* y,
+		       const struct svm_parameter& param);
+double* svm_gram_base(const svm_node* const* x, int n,
+		      const struct svm_parameter& param);
+void svm_gram_kernel(const double* base, int n,
+		     const struct svm_parameter& param, double* gram);
+struct svm_node* svm_precomputed_row(const double* gram, int n, int row,
+				     const std::vector<int>& cols);
+struct svm_problem svm_precomputed_problem(const double* gram, int n,
+					   const std::vector<int>& rows,
+					   const double* y);
 #endif
@@ -23,7 +23,7 @@ struct svm_problem
 };
 
 enum { C_SVC, NU_SVC, ONE_CLASS, EPSILON_SVR, NU_SVR };	/* svm_type */
-enum { LINEAR, POLY, RBF, SIGMOID, PRECOMPUTED }; /* kernel_type */
+enum { LINEAR, POLY, RBF, SIGMOID, CHIS,RBFCHIS, INTERS,PRECOMPUTED }; /* kernel_type */
 
 struct svm_parameter
 {
@@ -32,6 +32,7 @@ struct svm_parameter
 	int degree;	/* for poly */
 	double gamma;	/* for poly/rbf/sigmoid */
 	double coef0;	/* for poly/sigmoid */
+  double A; /* for rbfchis */
 
 	/* these are for training only */
 	double cache_size; /* in MB */
@@ -44,6 +45,7 @@ struct svm_parameter
 	double p;	/* for EPSILON_SVR */
 	int shrinking;	/* use the shrinking heuristics */
 	int probability; /* do probability estimates */
+	int parallel_fill;	/* kernel columns of at least this length are filled by several threads (0: never) */
 };
 
 //
@@ -69,9 +71,15 @@ struct svm_model
 	/* XXX */
 	int free_sv;		/* 1 if svm_model is created by svm_load_model*/
 				/* 0 if svm_model is created by svm_train */
+
+	/* for CHIS, RBFCHIS and INTERS kernels */
+	float *SV_dense;	/* SVs as contiguous float rows (NULL: sparse path) */
+	int dense_dim;		/* padded length of a row of SV_dense */
 };
 
 struct svm_model *svm_train(const struct svm_problem *prob, const struct svm_parameter *param);
+struct svm_model *svm_train_warm(const struct svm_problem *prob, const struct svm_parameter *param,
+				 double *alpha, double *G);
 void svm_cross_validation(const struct svm_problem *prob, const struct svm_parameter *param, int nr_fold, double *target);
 
 int svm_save_model(const char *model_file_name, const struct svm_model *model);
@@ -84,10 +92,15 @@ void svm_get_sv_indices(const struct svm_model *model, int *sv_indices);
 int svm_get_nr_sv(const struct svm_model *model);
 double svm_get_svr_probability(const struct svm_model *model);
 
+void svm_kernel_values(const struct svm_model *model, const struct svm_node *x, double *kvalue, float *row);
+double svm_k_function(const struct svm_node *x, const struct svm_node *y, const struct svm_parameter *param);
+/* the part of svm_k_function which does not depend on gamma */
+double svm_k_base(const struct svm_node *x, const struct svm_node *y, const struct svm_parameter *param);
 double svm_predict_values(const struct svm_model *model, const struct svm_node *x, double* dec_values);
 double svm_predict(const struct svm_model *model, const struct svm_node *x);
 double svm_predict_probability(const struct svm_model *model, const struct svm_node *x, double* prob_estimates);
 
+void svm_build_dense_sv(struct svm_model *model);
 void svm_free_model_content(struct svm_model *model_ptr);
 void svm_free_and_destroy_model(struct svm_model **model_ptr_ptr);
 void svm_destroy_param(struct svm_parameter *param);
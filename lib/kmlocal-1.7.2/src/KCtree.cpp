@@ -26,16 +26,19 @@
 //  Declaration of local utilities.  These are used in getNeighbors().
 //----------------------------------------------------------------------
 static int closestToBox(		// get closest point to box center
+    KCcontext		&ctx,			// traversal state
     KMctrIdxArray	cands,			// candidates for closest
     int			kCands,			// number of candidates
     KMorthRect		&bnd_box);		// bounding box of cell
 
 static bool pruneTest(			// test whether to prune candidate
+    int			dim,			// dimension
     KMcenter		cand,			// candidate to test
     KMcenter		closeCand,		// closest candidate
     KMorthRect		&bnd_box);		// bounding box
 
 static void postNeigh(			// assign neighbors to center
+    KCcontext		&ctx,			// traversal state
     KCptr		p,			// the node posting
     KMpoint		sum,			// the sum of coordinates
     double		sumSq,			// the sum of squares
@@ -95,30 +98,34 @@ void KCtree::skeletonTree(		// construct skeleton tree
 }
 
 //----------------------------------------------------------------------
-//  BasicGlobals - global variables
+//  Basic context
 // 	To prevent long argument lists in a number of the tree traversal
-// 	programs, we store a number of common global variables here.
-// 	In the case of construction, these are initialized before
-// 	calling buildKcTree.  They are used in getNeighbors() and by
-// 	sampleCtr().
+// 	programs, the common values are stored in a KCcontext (see
+// 	KCtree.h) which is passed down the recursion.  The basic part
+// 	(dimension and points) is used in makeSums(), getNeighbors()
+// 	and by sampleCtr().
 //----------------------------------------------------------------------
 
-int		kcDim;			// dimension of space
-int		kcDataSize;		// number of data points
-KMdataArray	kcPoints;		// data points
-
 //----------------------------------------------------------------------
-//  initBasicGlobals - initialize basic globals
+//  initBasicContext - initialize basic context
 //----------------------------------------------------------------------
 
-static void initBasicGlobals(		// initialize basic globals
+static void initBasicContext(		// initialize basic context
+    KCcontext		&ctx,			// context (returned)
     int			dim,			// dimension
     int			data_size,		// number of data points
     KMdataArray		data_pts)		// data points
 {
-    kcDim = dim;
-    kcDataSize = data_size;
-    kcPoints = data_pts;
+    ctx.dim = dim;
+    ctx.dataSize = data_size;
+    ctx.points = data_pts;
+    ctx.kCtrs = 0;
+    ctx.weights = NULL;
+    ctx.centers = NULL;
+    ctx.sums = NULL;
+    ctx.sumSqs = NULL;
+    ctx.dists = NULL;
+    ctx.boxMidpt = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -157,7 +164,8 @@ KCtree::KCtree(			// construct from point array
 {
     					// set up the basic stuff
     skeletonTree(pa, n, dd, n_max, bb_lo, bb_hi, NULL);
-    initBasicGlobals(dd, n, pa);	// initialize globals
+    KCcontext ctx;
+    initBasicContext(ctx, dd, n, pa);	// initialize context
 
     root = buildKcTree(pa, pidx, n, dd, bnd_box);
 
@@ -165,7 +173,7 @@ KCtree::KCtree(			// construct from point array
     KMpoint ignoreMe2;
     double ignoreMe3;
     					// compute sums
-    root->makeSums(ignoreMe1, ignoreMe2, ignoreMe3);
+    root->makeSums(ctx, ignoreMe1, ignoreMe2, ignoreMe3);
     assert(ignoreMe1 == n);		// should be all the points
 }
 
@@ -247,15 +255,16 @@ KCptr KCtree::buildKcTree(	// recursive construction of kc-tree
 //----------------------------------------------------------------------
 
 void KCnode::cellMidpt(	// compute cell midpoint
+    int		dim,			// dimension
     KMpoint	pt)			// the midpoint (returned)
 {
-    for (int d = 0; d < kcDim; d++) {		// compute box midpoint
+    for (int d = 0; d < dim; d++) {		// compute box midpoint
 	pt[d] = (bnd_box.lo[d] + bnd_box.hi[d])/2;
     }
 }
 
-KMpoint KCleaf::getPoint()		// get data point
-{  return (n_data == 1 ? kcPoints[bkt[0]] : NULL);  }
+KMpoint KCleaf::getPoint(KCcontext& ctx)	// get data point
+{  return (n_data == 1 ? ctx.points[bkt[0]] : NULL);  }
 
 
 //----------------------------------------------------------------------
@@ -270,6 +279,7 @@ KMpoint KCleaf::getPoint()		// get data point
 //----------------------------------------------------------------------
 
 void KCsplit::makeSums(
+    KCcontext		&ctx,			// traversal state
     int			&n,			// number of points (returned)
     KMpoint		&theSum,		// sum (returned)
     double		&theSumSq)		// sum of squares (returned)
@@ -283,9 +293,9 @@ void KCsplit::makeSums(
     						// process each child
     for (int i = KM_LO; i <= KM_HI; i++) {
     						// visit low child
-	child[i]->makeSums(n_child, s_child, ssq_child);
+	child[i]->makeSums(ctx, n_child, s_child, ssq_child);
 	n_data += n_child;			// increment no. points
-	for (int d = 0; d < kcDim; d++) {	// update sum and sumSq
+	for (int d = 0; d < ctx.dim; d++) {	// update sum and sumSq
 	    sum[d] += s_child[d];
 	}
 	sumSq += ssq_child;
@@ -297,6 +307,7 @@ void KCsplit::makeSums(
 
 //----------------------------------------------------------------------
 void KCleaf::makeSums(
+    KCcontext		&ctx,			// traversal state
     int			&n,			// number of points (returned)
     KMpoint		&theSum,		// sum (returned)
     double		&theSumSq)		// sum of squares (returned)
@@ -305,8 +316,8 @@ void KCleaf::makeSums(
 
     sumSq = 0;
     for (int i = 0; i < n_data; i++) {		// compute sum
-	for (int d = 0; d < kcDim; d++) {
-	    KMcoord theCoord = kcPoints[bkt[i]][d];
+	for (int d = 0; d < ctx.dim; d++) {
+	    KMcoord theCoord = ctx.points[bkt[i]][d];
 	    sum[d] += theCoord;
 	    sumSq += theCoord * theCoord;
 	}
@@ -369,10 +380,11 @@ KCnode::~KCnode()		// node destructor
 
 void KCtree::sampleCtr(KMpoint c)		// sample a point
 {
-    initBasicGlobals(dim, n_pts, pts);		// initialize globals
+    KCcontext ctx;
+    initBasicContext(ctx, dim, n_pts, pts);	// initialize context
     // TODO: bb_save check is just for debugging.
     KMorthRect bb_save(dim, bnd_box);		// save bounding box
-    root->sampleCtr(c, bnd_box);		// start at root
+    root->sampleCtr(ctx, c, bnd_box);		// start at root
     for (int i = 0; i < dim; i++) {		// check that bnd_box unchanged
 	assert(bb_save.lo[i] == bnd_box.lo[i] &&
 	       bb_save.hi[i] == bnd_box.hi[i]);
@@ -380,35 +392,37 @@ void KCtree::sampleCtr(KMpoint c)		// sample a point
 }
 
 void KCsplit::sampleCtr(			// sample from splitting node
+    KCcontext		&ctx,			// traversal state
     KMpoint		c,			// the sampled point (returned)
     KMorthRect		&bnd_box)		// bounding box for current node
 {
     int r = kmRanInt(n_nodes());		// random integer [0..n_nodes-1]
     if (r == 0) {				// sample from this node
-	KMorthRect expBox(kcDim);
-	bnd_box.expand(kcDim, 3, expBox);	// compute 3x expanded box
-	expBox.sample(kcDim, c);		// sample c from box
+	KMorthRect expBox(ctx.dim);
+	bnd_box.expand(ctx.dim, 3, expBox);	// compute 3x expanded box
+	expBox.sample(ctx.dim, c);		// sample c from box
     }
     else if (r <= child[KM_LO]->n_nodes()) {	// sample from left
 	KMcoord save = bnd_box.hi[cut_dim];	// save old upper bound
 	bnd_box.hi[cut_dim] = cut_val;		// modify for left subtree
-	child[KM_LO]->sampleCtr(c, bnd_box);
+	child[KM_LO]->sampleCtr(ctx, c, bnd_box);
 	bnd_box.hi[cut_dim] = save;		// restore upper bound
     }
     else {					// sample from right subtree
 	KMcoord save = bnd_box.lo[cut_dim];	// save old lower bound
 	bnd_box.lo[cut_dim] = cut_val;		// modify for right subtree
-	child[KM_HI]->sampleCtr(c,  bnd_box);
+	child[KM_HI]->sampleCtr(ctx, c,  bnd_box);
 	bnd_box.lo[cut_dim] = save;		// restore lower bound
     }
 }
 
 void KCleaf::sampleCtr(				// sample from leaf node
+    KCcontext		&ctx,			// traversal state
     KMpoint		c,			// the sampled point (returned)
     KMorthRect		&bnd_box)		// bounding box for current node
 {
     int ri = kmRanInt(n_data);			// generate random index
-    kmCopyPt(kcDim, kcPoints[bkt[ri]], c);	// copy to destination
+    kmCopyPt(ctx.dim, ctx.points[bkt[ri]], c);	// copy to destination
 }
 
 //----------------------------------------------------------------------
@@ -427,10 +441,11 @@ void KCleaf::sampleCtr(				// sample from leaf node
 //----------------------------------------------------------------------
 
 void KCsplit::print(		// print splitting node
+    KCcontext	&ctx,			// traversal state
     int		level)			// depth of node in tree
 {
     					// print high child
-    child[KM_HI]->print(level+1);
+    child[KM_HI]->print(ctx, level+1);
 
     *kmOut << "    ";			// print indentation
     for (int i = 0; i < level; i++)
@@ -440,14 +455,15 @@ void KCsplit::print(		// print splitting node
     *kmOut << "Split"			// print without address
         << " cd=" << cut_dim << " cv=" << setw(6) << cut_val
        	<< " nd=" << n_data
-       	<< " sm=";  kmPrintPt(sum, kcDim, true);
+       	<< " sm=";  kmPrintPt(sum, ctx.dim, true);
     *kmOut << " ss=" << sumSq << "\n";
     					// print low child
-    child[KM_LO]->print(level+1);
+    child[KM_LO]->print(ctx, level+1);
 }
 
 //----------------------------------------------------------------------
 void KCleaf::print(			// print leaf node
+    KCcontext	&ctx,			// traversal state
     int		level)			// depth of node in tree
 {
     *kmOut << "    ";
@@ -462,7 +478,7 @@ void KCleaf::print(			// print leaf node
 	if (j < n_data-1) *kmOut << ",";
     }
     *kmOut << ">"
-       	<< " sm=";  kmPrintPt(sum, kcDim, true);
+       	<< " sm=";  kmPrintPt(sum, ctx.dim, true);
     *kmOut << " ss=" << sumSq << "\n";
 }
 
@@ -474,62 +490,57 @@ void KCtree::print(			// print entire tree
 	*kmOut << "    Points:\n";
 	for (int i = 0; i < n_pts; i++) {
 	    *kmOut << "\t" << i << ": ";
-	    kmPrintPt(pts[i], kcDim, true);
+	    kmPrintPt(pts[i], dim, true);
             *kmOut << "\n";
 	}
     }
     if (root == NULL)			// empty tree?
 	*kmOut << "    Null tree.\n";
     else {
-    	root->print(0);			// invoke printing at root
+	KCcontext ctx;
+	initBasicContext(ctx, dim, n_pts, pts);
+    	root->print(ctx, 0);		// invoke printing at root
     }
 }
 
 //----------------------------------------------------------------------
-// DistGlobals - globals used in computing distortions
+// Distortion context
 // 	To prevent long argument lists in the computation of
-// 	distortions, we store a number of common global variables here.
-// 	These are initialized in KCtree::getNeighbors.
-//
-// 	Note: kcDim and kcPoints (from Basic Globals) are used as well.
+// 	distortions, the centers and the sums being accumulated are
+// 	stored in the KCcontext as well.  They are initialized in
+// 	KCtree::getNeighbors and KCtree::getAssignments.
 //----------------------------------------------------------------------
 
-int		kcKCtrs;		// number of centers
-int*		kcWeights;		// weights of each point
-KMpointArray	kcCenters;		// the center points
-KMpointArray	kcSums;			// sums
-double*		kcSumSqs;		// sum of squares
-double*		kcDists;		// distortions
-KMpoint		kcBoxMidpt;		// bounding-box midpoint
-
 //----------------------------------------------------------------------
-//  initDistGlobals - initialize distortion globals
+//  initDistContext - initialize distortion context
 //----------------------------------------------------------------------
 
-static void initDistGlobals(		// initialize distortion globals
-    KMfilterCenters& ctrs)			// the centers
+static void initDistContext(		// initialize distortion context
+    KCcontext		&ctx,			// context (returned)
+    KMfilterCenters&	ctrs)			// the centers
 {
-    initBasicGlobals(ctrs.getDim(), ctrs.getNPts(), ctrs.getDataPts());
-    kcKCtrs	= ctrs.getK();
-    kcCenters	= ctrs.getCtrPts();		// get ptrs to KMcenter arrays
-    kcWeights	= ctrs.getWeights(false);
-    kcSums	= ctrs.getSums(false);
-    kcSumSqs	= ctrs.getSumSqs(false);
-    kcDists	= ctrs.getDists(false);
-    kcBoxMidpt  = kmAllocPt(kcDim);
-
-    for (int j = 0; j < kcKCtrs; j++) {		// initialize sums
-	kcWeights[j] = 0;
-	kcSumSqs[j] = 0;
-	for (int d = 0; d < kcDim; d++) {
-    	    kcSums[j][d] = 0;
+    initBasicContext(ctx, ctrs.getDim(), ctrs.getNPts(), ctrs.getDataPts());
+    ctx.kCtrs	= ctrs.getK();
+    ctx.centers	= ctrs.getCtrPts();		// get ptrs to KMcenter arrays
+    ctx.weights	= ctrs.getWeights(false);
+    ctx.sums	= ctrs.getSums(false);
+    ctx.sumSqs	= ctrs.getSumSqs(false);
+    ctx.dists	= ctrs.getDists(false);
+    ctx.boxMidpt = kmAllocPt(ctx.dim);
+
+    for (int j = 0; j < ctx.kCtrs; j++) {	// initialize sums
+	ctx.weights[j] = 0;
+	ctx.sumSqs[j] = 0;
+	for (int d = 0; d < ctx.dim; d++) {
+    	    ctx.sums[j][d] = 0;
 	}
     }
 }
 
-static void deleteDistGlobals()		// delete distortion globals
+static void deleteDistContext(		// delete distortion context
+    KCcontext		&ctx)			// the context
 {
-    kmDeallocPt(kcBoxMidpt);
+    kmDeallocPt(ctx.boxMidpt);
 }
 
 //----------------------------------------------------------------------
@@ -564,70 +575,74 @@ static void deleteDistGlobals()		// delete distortion globals
 void KCtree::getNeighbors(		// compute neighbors for centers
     KMfilterCenters& ctrs)			// the centers
 {
-    initDistGlobals(ctrs);			// initialize globals
-    int *candIdx = new int[kcKCtrs];		// allocate center indices
-    for (int j = 0; j < kcKCtrs; j++) {		// initialize everything
+    KCcontext ctx;
+    initDistContext(ctx, ctrs);			// initialize context
+    int *candIdx = new int[ctx.kCtrs];		// allocate center indices
+    for (int j = 0; j < ctx.kCtrs; j++) {	// initialize everything
     	candIdx[j] = j;				// initialize indices
     }
-    root->getNeighbors(candIdx, kcKCtrs);	// get neighbors for tree
+    root->getNeighbors(ctx, candIdx, ctx.kCtrs);// get neighbors for tree
     delete [] candIdx;				// delete center indices
-    deleteDistGlobals();			// delete globals
+    deleteDistContext(ctx);			// delete context
 }
 
 //----------------------------------------------------------------------
 void KCsplit::getNeighbors(		// get neighbors for internal node
+    KCcontext		&ctx,			// traversal state
     KMctrIdxArray	cands,			// candidate centers
     int			kCands)			// number of centers
 {
     if (kCands == 1) {				// only one cand left?
 						// post points as neighbors
-    	postNeigh(this, sum, sumSq, n_data, cands[0]);
+    	postNeigh(ctx, this, sum, sumSq, n_data, cands[0]);
     }
     else {
     						// get closest cand to box
-	int cc = closestToBox(cands, kCands, bnd_box);
+	int cc = closestToBox(ctx, cands, kCands, bnd_box);
 	KMctrIdx closeCand = cands[cc];		// closest candidate index
 						// space for new candidates
 	KMctrIdxArray newCands = new KMctrIdx[kCands];
 	int newK = 0;				// number of new candidates
 	for (int j = 0; j < kCands; j++) {
 	    if (j == cc || !pruneTest(		// is candidate close enough?
-	    			kcCenters[cands[j]],
-	    			kcCenters[closeCand],
+				ctx.dim,
+	    			ctx.centers[cands[j]],
+	    			ctx.centers[closeCand],
 				bnd_box)) {
 	    	newCands[newK++] = cands[j];	// yes, keep it
 	    }
 	}
 						// apply to children
-	child[KM_LO]->getNeighbors(newCands, newK);
-	child[KM_HI]->getNeighbors(newCands, newK);
+	child[KM_LO]->getNeighbors(ctx, newCands, newK);
+	child[KM_HI]->getNeighbors(ctx, newCands, newK);
 	delete [] newCands;			// delete new candidates
     }
 }
 
 //----------------------------------------------------------------------
 void KCleaf::getNeighbors(		// get neighbors for leaf node
+    KCcontext		&ctx,			// traversal state
     KMctrIdxArray	cands,			// candidate centers
     int			kCands)			// number of centers
 {
     if (kCands == 1) {				// only one cand left?
 						// post points as neighbors
-    	postNeigh(this, sum, sumSq, n_data, cands[0]);
+    	postNeigh(ctx, this, sum, sumSq, n_data, cands[0]);
     }
     else {					// find closest centers
 	for (int i = 0; i < n_data; i++) {	// for each point in bucket
 	    KMdist minDist = KM_DIST_INF;	// distance to nearest point
 	    int minK = 0;			// index of this point
-	    KMpoint thisPt = kcPoints[bkt[i]];	// this data point
+	    KMpoint thisPt = ctx.points[bkt[i]];	// this data point
 
 	    for (int j = 0; j < kCands; j++) {	// compute closest candidate
-		KMdist dist = kmDist(kcDim, kcCenters[cands[j]], thisPt);
+		KMdist dist = kmDist(ctx.dim, ctx.centers[cands[j]], thisPt);
         	if (dist < minDist) {		// best so far?
         	    minDist = dist;		// yes, save it
 		    minK = j;			// ...and its index
 		}
 	    }
-    	    postNeigh(this, kcPoints[bkt[i]], sumSq, 1, cands[minK]);
+    	    postNeigh(ctx, this, ctx.points[bkt[i]], sumSq, 1, cands[minK]);
 	}
     }
 }
@@ -649,20 +664,22 @@ void KCtree::getAssignments(		// compute assignments for points
     KMctrIdxArray 	closeCtr,		// closest center per point
     double*	 	sqDist)			// sq'd distance to center
 {
-    initDistGlobals(ctrs);			// initialize globals
+    KCcontext ctx;
+    initDistContext(ctx, ctrs);			// initialize context
 
-    int *candIdx = new int[kcKCtrs];		// allocate center indices
-    for (int j = 0; j < kcKCtrs; j++) {		// initialize everything
+    int *candIdx = new int[ctx.kCtrs];		// allocate center indices
+    for (int j = 0; j < ctx.kCtrs; j++) {	// initialize everything
     	candIdx[j] = j;				// initialize indices
     }
     						// search the tree
-    root->getAssignments(candIdx, kcKCtrs, closeCtr, sqDist);
+    root->getAssignments(ctx, candIdx, ctx.kCtrs, closeCtr, sqDist);
     delete [] candIdx;				// delete center indices
-    deleteDistGlobals();			// delete globals
+    deleteDistContext(ctx);			// delete context
 }
 
 //----------------------------------------------------------------------
 void KCsplit::getAssignments(		// get assignments for internal node
+    KCcontext		&ctx,			// traversal state
     KMctrIdxArray	cands,			// candidate centers
     int			kCands,			// number of centers
     KMctrIdxArray 	closeCtr,		// closest center per point
@@ -670,33 +687,35 @@ void KCsplit::getAssignments(		// get assignments for internal node
 {
     if (kCands == 1) {				// only one cand left?
 						// no more pruning needed
-	child[KM_LO]->getAssignments(cands, kCands, closeCtr, sqDist);
-	child[KM_HI]->getAssignments(cands, kCands, closeCtr, sqDist);
+	child[KM_LO]->getAssignments(ctx, cands, kCands, closeCtr, sqDist);
+	child[KM_HI]->getAssignments(ctx, cands, kCands, closeCtr, sqDist);
     }
     else {
     						// get closest cand to box
-	int cc = closestToBox(cands, kCands, bnd_box);
+	int cc = closestToBox(ctx, cands, kCands, bnd_box);
 	KMctrIdx closeCand = cands[cc];		// closest candidate index
 						// space for new candidates
 	KMctrIdxArray newCands = new KMctrIdx[kCands];
 	int newK = 0;				// number of new candidates
 	for (int j = 0; j < kCands; j++) {
 	    if (j == cc || !pruneTest(		// is candidate close enough?
-	    			kcCenters[cands[j]],
-	    			kcCenters[closeCand],
+				ctx.dim,
+	    			ctx.centers[cands[j]],
+	    			ctx.centers[closeCand],
 				bnd_box)) {
 	    	newCands[newK++] = cands[j];	// yes, keep it
 	    }
 	}
 						// apply to children
-	child[KM_LO]->getAssignments(newCands, newK, closeCtr, sqDist);
-	child[KM_HI]->getAssignments(newCands, newK, closeCtr, sqDist);
+	child[KM_LO]->getAssignments(ctx, newCands, newK, closeCtr, sqDist);
+	child[KM_HI]->getAssignments(ctx, newCands, newK, closeCtr, sqDist);
 	delete [] newCands;			// delete new candidates
     }
 }
 
 //----------------------------------------------------------------------
 void KCleaf::getAssignments(		// get assignments for leaf node
+    KCcontext		&ctx,			// traversal state
     KMctrIdxArray	cands,			// candidate centers
     int			kCands,			// number of centers
     KMctrIdxArray 	closeCtr,		// closest center per point
@@ -705,10 +724,10 @@ void KCleaf::getAssignments(		// get assignments for leaf node
     for (int i = 0; i < n_data; i++) {		// for each point in bucket
 	KMdist minDist = KM_DIST_INF;		// distance to nearest point
 	int minK = 0;				// index of this point
-	KMpoint thisPt = kcPoints[bkt[i]];	// this data point
+	KMpoint thisPt = ctx.points[bkt[i]];	// this data point
 
 	for (int j = 0; j < kCands; j++) {	// compute closest candidate
-	    KMdist dist = kmDist(kcDim, kcCenters[cands[j]], thisPt);
+	    KMdist dist = kmDist(ctx.dim, ctx.centers[cands[j]], thisPt);
 	    if (dist < minDist) {		// best so far?
 		minDist = dist;			// yes, save it
 		minK = j;			// ...and its index
@@ -728,24 +747,25 @@ void KCleaf::getAssignments(		// get assignments for leaf node
 //	This procedure is given a list of candidates (cands), the number
 //	of candidates (kCands), and a cell (bnd_box), and returns the
 //	index (in cands) of the element of cands that is closest to the
-//	midpoint of the cell.  The global variable kcBoxMidpt is used to
-//	store the cell midpoint.
+//	midpoint of the cell.  The context's boxMidpt is used to store
+//	the cell midpoint.
 //----------------------------------------------------------------------
 
 static int closestToBox(		// get closest point to box center
+    KCcontext		&ctx,			// traversal state
     KMctrIdxArray	cands,			// candidates for closest
     int			kCands,			// number of candidates
     KMorthRect		&bnd_box)		// bounding box of cell
 {
-    for (int d = 0; d < kcDim; d++) {		// compute midpoint
-	kcBoxMidpt[d] = (bnd_box.lo[d] + bnd_box.hi[d])/2;
+    for (int d = 0; d < ctx.dim; d++) {		// compute midpoint
+	ctx.boxMidpt[d] = (bnd_box.lo[d] + bnd_box.hi[d])/2;
     }
 
     KMdist minDist = KM_DIST_INF;		// distance to nearest point
     int minK = 0;				// index of this point
 
     for (int j = 0; j < kCands; j++) {		// compute dist to each point
-        KMdist dist = kmDist(kcDim, kcCenters[cands[j]], kcBoxMidpt);
+        KMdist dist = kmDist(ctx.dim, ctx.centers[cands[j]], ctx.boxMidpt);
         if (dist < minDist) {			// best so far?
             minDist = dist;			// yes, save it
 	    minK = j;				// ...and its index
@@ -784,13 +804,14 @@ static int closestToBox(		// get closest point to box center
 //----------------------------------------------------------------------
 
 static bool pruneTest(
+    int			dim,			// dimension
     KMcenter		cand,			// candidate to test
     KMcenter		closeCand,		// closest candidate
     KMorthRect		&bnd_box)		// bounding box
 {
     double boxDot = 0;				// holds (p-c').(c-c')
     double ccDot = 0;				// holds (c-c').(c-c')
-    for (int d = 0; d < kcDim; d++) {
+    for (int d = 0; d < dim; d++) {
     	double ccComp = cand[d] - closeCand[d];	// one component c-c'
 	ccDot += ccComp * ccComp;		// increment dot product
 	if (ccComp > 0) {			// candidate on high side
@@ -815,15 +836,16 @@ static bool pruneTest(
 //----------------------------------------------------------------------
 
 static void postNeigh(
+    KCcontext		&ctx,			// traversal state
     KCptr		p,			// the node posting
     KMpoint		sum,			// the sum of coordinates
     double		sumSq,			// the sum of squares
     int			n_data,			// number of points
     KMctrIdx		ctrIdx)			// center index
 {
-    for (int d = 0; d < kcDim; d++) {			// increment sum
-	kcSums[ctrIdx][d] += sum[d];
+    for (int d = 0; d < ctx.dim; d++) {			// increment sum
+	ctx.sums[ctrIdx][d] += sum[d];
     }
-    kcWeights[ctrIdx] += n_data;			// increment weight
-    kcSumSqs[ctrIdx] += sumSq;				// incr sum of squares
+    ctx.weights[ctrIdx] += n_data;			// increment weight
+    ctx.sumSqs[ctrIdx] += sumSq;			// incr sum of squares
 }
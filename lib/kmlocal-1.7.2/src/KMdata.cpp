@@ -25,10 +25,33 @@
 KMdata::KMdata(int d, int n) : dim(d), maxPts(n), nPts(n) {
     pts = kmAllocPts(n, d);
     kcTree = NULL;
+    ownPts = true;
+}
+					// subset view constructor
+KMdata::KMdata(const KMdata& base, KMdatIdxArray idx, int n)
+    : dim(base.dim), maxPts(n), nPts(n) {
+    pts = new KMpoint[n];			// only the row pointers
+    for (int i = 0; i < n; i++) {
+	assert(idx[i] >= 0 && idx[i] < base.nPts);
+	pts[i] = base.pts[idx[i]];		// share the base coordinates
+    }
+    kcTree = NULL;
+    ownPts = false;
+}
+					// range view constructor
+KMdata::KMdata(const KMdata& base, int first, int n)
+    : dim(base.dim), maxPts(n), nPts(n) {
+    assert(first >= 0 && first + n <= base.nPts);
+    pts = new KMpoint[n];			// only the row pointers
+    for (int i = 0; i < n; i++)
+	pts[i] = base.pts[first + i];		// share the base coordinates
+    kcTree = NULL;
+    ownPts = false;
 }
 
 KMdata::~KMdata() {			// destructor
-    kmDeallocPts(pts);				// deallocate point array
+    if (ownPts) kmDeallocPts(pts);		// deallocate point array
+    else delete [] pts;				// views own only the rows
     delete kcTree;				// deallocate kc-tree
 }
 
@@ -38,11 +61,13 @@ void KMdata::buildKcTree() {		// build kc-tree for points
 }
 
 void KMdata::resize(int d, int n) {	// resize point array
-    if (d != dim || n != nPts) {		// size change?
+    if (d != dim || n != nPts || !ownPts) {	// size change?
 	dim = d;
-	nPts = n;
-	kmDeallocPts(pts);			// deallocate old points
+	nPts = maxPts = n;
+	if (ownPts) kmDeallocPts(pts);		// deallocate old points
+	else delete [] pts;			// a view becomes a real set
 	pts = kmAllocPts(nPts, dim);
+	ownPts = true;
     }
     if (kcTree != NULL) {			// kc-tree exists?
 	delete kcTree;				// deallocate kc-tree
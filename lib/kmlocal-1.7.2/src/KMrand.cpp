@@ -20,79 +20,70 @@
 
 #include "KMrand.h"			// random generator declarations
 
-#ifdef WIN32				// Visual C++ (no srandom/random)
-void srandom(unsigned int seed) { srand(seed); }
-long random(void) { return long(rand()); }
-#endif
-
 //----------------------------------------------------------------------
 //  Globals
+//	The generator state is kept per thread (see KMrand.h), so that
+//	several k-means runs can draw random numbers concurrently
+//	without sharing (or locking) a common sequence.
 //----------------------------------------------------------------------
-int	kmIdum = 0;			// used for random number generation
+KM_THREAD int	kmIdum = 0;		// used for random number generation
 
 //------------------------------------------------------------------------
 //	kmRan0 - (safer) uniform random number generator
 //
 //	The code given here is taken from "Numerical Recipes in C" by
 //	William Press, Brian Flannery, Saul Teukolsky, and William
-//	Vetterling. The task of the code is to do an additional randomizing
-//	shuffle on the system-supplied random number generator to make it
-//	safer to use. 
+//	Vetterling (ran1).  It is the "minimal standard" generator of
+//	Park and Miller with a Bays-Durham shuffle.  Unlike the system
+//	routine "random()", all its state is local to the calling
+//	thread.
 //
-//	Returns a uniform deviate between 0.0 and 1.0 using the
-//	system-supplied routine "random()". Set kmIdum to any negative value
-//	to initialise or reinitialise the sequence.
+//	Returns a uniform deviate between 0.0 and 1.0 (exclusive of the
+//	endpoint values). Set kmIdum to any negative value to initialise
+//	or reinitialise the sequence of the calling thread.
 //------------------------------------------------------------------------
 
+const int    KM_IA   = 16807;		// Park-Miller constants
+const int    KM_IM   = 2147483647;
+const double KM_AM   = 1.0/KM_IM;
+const int    KM_IQ   = 127773;
+const int    KM_IR   = 2836;
+const int    KM_NTAB = 32;		// size of the shuffle table
+const int    KM_NDIV = 1+(KM_IM-1)/KM_NTAB;
+const double KM_RNMX = 1.0-1.2e-7;	// largest value returned
+
+static KM_THREAD int kmIy = 0;		// last value (0: not initialized)
+static KM_THREAD int kmIv[KM_NTAB];	// shuffle table
+
 static double kmRan0()
 {
-    int j;
-
-    static double y, maxran, v[98];	// The exact number 98 is unimportant
-    static int iff = 0;
-
-    // As a precaution against misuse, we will always initialize on the first
-    // call, even if "kmIdum" is not set negative. Determine "maxran", the
-    // next integer after the largest representable value of type int. We
-    // assume this is a factor of 2 smaller than the corresponding value of
-    // type unsigned int. 
-
-    if (kmIdum < 0 || iff == 0) {	// initialize
-		/* compute maximum random number */
-#ifdef WIN32				// Microsoft Visual C++
-	maxran = RAND_MAX;
-#else
-	unsigned i, k;
-	i = 2;
-	do {
-	    k = i;
-	    i <<= 1;
-	} while (i);
-	maxran = (double) k;
-#endif
- 	iff = 1;
-  
-	srandom(kmIdum);
-	kmIdum = 1;
-
-	for (j = 1; j <= 97; j++)	// exercise the system routine
-	    random();			// (value intentionally ignored)
-
-	for (j = 1; j <= 97; j++)	// Then save 97 values and a 98th
-	    v[j] = random();
-	y = random();
-     }
-
-    // This is where we start if not initializing. Use the previously saved
-    // random number y to get an index j between 1 and 97. Then use the
-    // corresponding v[j] for both the next j and as the output number. */
-
-    j = 1 + (int) (97.0 * (y / maxran));
-    y = v[j];
-    v[j] = random();			// Finally, refill the table entry
-					// with the next random number from
-					// "random()" 
-    return(y / maxran);
+    int j, k;
+
+    // As a precaution against misuse, we will always initialize on the
+    // first call, even if "kmIdum" is not set negative.
+
+    if (kmIdum <= 0 || kmIy == 0) {	// initialize
+	if (kmIdum < 0 && kmIdum != -KM_HUGE_INT-1)
+	    kmIdum = -kmIdum;			// the seed
+	if (kmIdum <= 0 || kmIdum == KM_IM)	// (0 is a fixed point)
+	    kmIdum = 1;
+	for (j = KM_NTAB+7; j >= 0; j--) {	// load the shuffle table
+	    k = kmIdum/KM_IQ;			// (after 8 warm-ups)
+	    kmIdum = KM_IA*(kmIdum-k*KM_IQ)-KM_IR*k;
+	    if (kmIdum < 0) kmIdum += KM_IM;
+	    if (j < KM_NTAB) kmIv[j] = kmIdum;
+	}
+	kmIy = kmIv[0];
+    }
+    k = kmIdum/KM_IQ;			// compute idum=(IA*idum) % IM
+    kmIdum = KM_IA*(kmIdum-k*KM_IQ)-KM_IR*k;	// without overflows
+    if (kmIdum < 0) kmIdum += KM_IM;
+    j = kmIy/KM_NDIV;			// index in the shuffle table
+    kmIy = kmIv[j];			// output the previous value
+    kmIv[j] = kmIdum;			// and refill the table
+
+    double temp = KM_AM*kmIy;
+    return (temp > KM_RNMX ? KM_RNMX : temp);
 }
 
 //------------------------------------------------------------------------
@@ -128,8 +119,8 @@ double kmRanUnif(
 
 static double kmRanGauss()
 {
-    static int iset=0;
-    static double gset;
+    static KM_THREAD int iset=0;
+    static KM_THREAD double gset;
 
     if (iset == 0) {			// we don't have a deviate handy
 	double v1, v2;
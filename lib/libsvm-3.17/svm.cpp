@@ -40,6 +40,105 @@ static inline double powi(double base, int times)
 #define TAU 1e-12
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
 
+//
+// Dense histograms (CHIS and INTERS kernels): the vectors are
+// copied into contiguous float rows padded to a multiple of
+// DENSE_WIDTH values, on which the kernels are branchless loops
+// vectorized by the compiler. The rows are floats but the sums are in
+// double (the vectors have up to DENSE_MAX_DIM values and the decision
+// values of the predictions go through these kernels too).
+// The sparse path is kept when a vector has
+// a negative value, or when the vectors are too long or too sparse.
+//
+#define DENSE_WIDTH 8		// floats of the widest SIMD register
+#define DENSE_MAX_DIM 65536
+#define DENSE_MIN_FILL 0.125	// minimum ratio of nonzero values
+
+static bool dense_kernel(int kernel_type)
+{
+	// RBFCHIS stays sparse: its distance ignores the bins after the end of
+	// the shorter vector, which the dense rows cannot tell
+	return kernel_type == CHIS || kernel_type == INTERS;
+}
+
+// padded dimension of the dense copy of x[0..n-1], 0 to keep the sparse path
+static int dense_dimension(const svm_node * const *x, int n)
+{
+	long nnz = 0;
+	int max_index = 0;
+	for(int i=0;i<n;i++)
+		for(const svm_node *p=x[i];p->index != -1;++p)
+		{
+			if(p->index < 1 || p->value < 0)
+				return 0;
+			if(p->index > max_index)
+				max_index = p->index;
+			nnz++;
+		}
+	if(max_index == 0 || max_index > DENSE_MAX_DIM ||
+	   nnz < DENSE_MIN_FILL*n*(double)max_index)
+		return 0;
+	return (max_index+DENSE_WIDTH-1)/DENSE_WIDTH*DENSE_WIDTH;
+}
+
+// false if px does not fit in a dense row of dimension dim
+static bool dense_row(const svm_node *px, float *row, int dim)
+{
+	for(int d=0;d<dim;d++)
+		row[d] = 0;
+	for(;px->index != -1;++px)
+	{
+		if(px->index < 1 || px->index > dim || px->value < 0)
+			return false;
+		row[px->index-1] = (float)px->value;
+	}
+	return true;
+}
+
+static double dense_chis(const float *px, const float *py, int dim)
+{
+	double acc[DENSE_WIDTH] = {0};
+	for(int d=0;d<dim;d+=DENSE_WIDTH)
+		for(int k=0;k<DENSE_WIDTH;k++)
+		{
+			double a = px[d+k], b = py[d+k], s = a+b;
+			acc[k] += a*b/(s > 0 ? s : 1);
+		}
+	double sum = 0;
+	for(int k=0;k<DENSE_WIDTH;k++)
+		sum += acc[k];
+	return sum;
+}
+
+static double dense_inters(const float *px, const float *py, int dim)
+{
+	double acc[DENSE_WIDTH] = {0};
+	for(int d=0;d<dim;d+=DENSE_WIDTH)
+		for(int k=0;k<DENSE_WIDTH;k++)
+		{
+			float a = px[d+k], b = py[d+k];
+			acc[k] += (a < b) ? a : b;
+		}
+	double sum = 0;
+	for(int k=0;k<DENSE_WIDTH;k++)
+		sum += acc[k];
+	return sum;
+}
+
+static double dense_k_function(const float *px, const float *py, int dim,
+			       int kernel_type)
+{
+	switch(kernel_type)
+	{
+		case CHIS:
+			return dense_chis(px,py,dim);
+		case INTERS:
+			return dense_inters(px,py,dim);
+		default:
+			return 0;  // Unreachable
+	}
+}
+
 static void print_string_stdout(const char *s)
 {
 	fputs(s,stdout);
@@ -208,21 +307,37 @@ public:
 
 	static double k_function(const svm_node *x, const svm_node *y,
 				 const svm_parameter& param);
+	static double k_base(const svm_node *x, const svm_node *y,
+			     const svm_parameter& param);
 	virtual Qfloat *get_Q(int column, int len) const = 0;
 	virtual double *get_QD() const = 0;
 	virtual void swap_index(int i, int j) const	// no so const...
 	{
 		swap(x[i],x[j]);
 		if(x_square) swap(x_square[i],x_square[j]);
+		if(dense_index) swap(dense_index[i],dense_index[j]);
 	}
 protected:
 
 	double (Kernel::*kernel_function)(int i, int j) const;
 
+	// the columns of at least parallel_fill values (computed ones) are
+	// filled by several threads (0: never)
+	const int parallel_fill;
+	bool fill_in_parallel(int n) const
+	{
+		return parallel_fill > 0 && n >= parallel_fill;
+	}
+
 private:
 	const svm_node **x;
 	double *x_square;
 
+	// dense rows of the vectors (NULL if the sparse path is used)
+	float *dense;
+	int dense_dim;
+	int *dense_index;
+
 	// svm_parameter
 	const int kernel_type;
 	const int degree;
@@ -256,17 +371,18 @@ private:
   }
   double kernel_rbfchis(int i,int j) const
   {
-    double v = exp(-1.0*chi_square_distance(x[i],x[j])/A);
-    static int count2 = 0;
-    if(count2 == 0){ count2++;
-          std::cerr<<"A internal: "<<A<<std::endl;
-    }
-    return v;
+    return exp(-1.0*chi_square_distance(x[i],x[j])/A);
   }
   double kernel_intersection(int i, int j) const
   {
     return inters(x[i],x[j]);
   }
+	double kernel_dense(int i, int j) const
+	{
+		return dense_k_function(dense+(size_t)dense_index[i]*dense_dim,
+					dense+(size_t)dense_index[j]*dense_dim,
+					dense_dim,kernel_type);
+	}
 	double kernel_precomputed(int i, int j) const
 	{
 		return x[i][(int)(x[j][0].value)].value;
@@ -274,7 +390,8 @@ private:
 };
 
 Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
-:kernel_type(param.kernel_type), degree(param.degree),
+:parallel_fill(param.parallel_fill),
+ kernel_type(param.kernel_type), degree(param.degree),
  gamma(param.gamma), coef0(param.coef0), A(param.A)
 {
 	switch(kernel_type)
@@ -315,12 +432,29 @@ Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
 	}
 	else
 		x_square = 0;
+
+	dense = 0;
+	dense_index = 0;
+	dense_dim = dense_kernel(kernel_type) ? dense_dimension(x_,l) : 0;
+	if(dense_dim > 0)
+	{
+		dense = Malloc(float,(size_t)l*dense_dim);
+		dense_index = new int[l];
+		for(int i=0;i<l;i++)
+		{
+			dense_row(x[i],dense+(size_t)i*dense_dim,dense_dim);
+			dense_index[i] = i;
+		}
+		kernel_function = &Kernel::kernel_dense;
+	}
 }
 
 Kernel::~Kernel()
 {
 	delete[] x;
 	delete[] x_square;
+	free(dense);
+	delete[] dense_index;
 }
 
 double Kernel::dot(const svm_node *px, const svm_node *py)
@@ -414,15 +548,16 @@ double Kernel::chi_square_distance(const svm_node *px, const svm_node *py){
 }
 
 
-double Kernel::k_function(const svm_node *x, const svm_node *y,
-			  const svm_parameter& param)
+//
+// the part of k_function which does not depend on gamma: the dot product
+// (LINEAR, POLY, SIGMOID), the squared distance (RBF) or the kernel value
+// itself (CHIS, RBFCHIS, INTERS, PRECOMPUTED)
+//
+double Kernel::k_base(const svm_node *x, const svm_node *y,
+		      const svm_parameter& param)
 {
 	switch(param.kernel_type)
 	{
-		case LINEAR:
-			return dot(x,y);
-		case POLY:
-			return powi(param.gamma*dot(x,y)+param.coef0,param.degree);
 		case RBF:
 		{
 			double sum = 0;
@@ -462,28 +597,35 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 				++y;
 			}
 			
-			return exp(-param.gamma*sum);
+			return sum;
 		}
-		case SIGMOID:
-			return tanh(param.gamma*dot(x,y)+param.coef0);
     case CHIS:
       return chis(x,y);
     case RBFCHIS:
-      {  
-        double v = exp(-1.0*chi_square_distance(x,y)/param.A);
-        static int  count1 = 0;
-        if(!count1){
-          count1++;
-          std::cerr<<"param.A: "<<param.A<<std::endl;
-        }
-        return v;
-      }
+      return exp(-1.0*chi_square_distance(x,y)/param.A);
     case INTERS:
       return inters(x,y);
 		case PRECOMPUTED:  //x: test (validation), y: SV
 			return x[(int)(y->value)].value;
+		default:	// LINEAR, POLY, SIGMOID
+			return dot(x,y);
+	}
+}
+
+double Kernel::k_function(const svm_node *x, const svm_node *y,
+			  const svm_parameter& param)
+{
+	double base = k_base(x,y,param);
+	switch(param.kernel_type)
+	{
+		case POLY:
+			return powi(param.gamma*base+param.coef0,param.degree);
+		case RBF:
+			return exp(-param.gamma*base);
+		case SIGMOID:
+			return tanh(param.gamma*base+param.coef0);
 		default:
-			return 0;  // Unreachable 
+			return base;
 	}
 }
 
@@ -520,7 +662,8 @@ public:
 
 	void Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		   double *alpha_, double Cp, double Cn, double eps,
-		   SolutionInfo* si, int shrinking);
+		   SolutionInfo* si, int shrinking,
+		   const double *G_init = NULL, double *G_out = NULL);
 protected:
 	int active_size;
 	schar *y;
@@ -616,9 +759,12 @@ void Solver::reconstruct_gradient()
 	}
 }
 
+// G_init: the gradient Q.alpha_ + p_ (warm start), or NULL to compute it
+// G_out: receives the final gradient (if not NULL)
 void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		   double *alpha_, double Cp, double Cn, double eps,
-		   SolutionInfo* si, int shrinking)
+		   SolutionInfo* si, int shrinking,
+		   const double *G_init, double *G_out)
 {
 	this->l = l;
 	this->Q = &Q;
@@ -653,17 +799,18 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		int i;
 		for(i=0;i<l;i++)
 		{
-			G[i] = p[i];
+			G[i] = (G_init != NULL) ? G_init[i] : p[i];
 			G_bar[i] = 0;
 		}
 		for(i=0;i<l;i++)
-			if(!is_lower_bound(i))
+			if(G_init != NULL ? is_upper_bound(i) : !is_lower_bound(i))
 			{
 				const Qfloat *Q_i = Q.get_Q(i,l);
 				double alpha_i = alpha[i];
 				int j;
-				for(j=0;j<l;j++)
-					G[j] += alpha_i*Q_i[j];
+				if(G_init == NULL)
+					for(j=0;j<l;j++)
+						G[j] += alpha_i*Q_i[j];
 				if(is_upper_bound(i))
 					for(j=0;j<l;j++)
 						G_bar[j] += get_C(i) * Q_i[j];
@@ -873,6 +1020,9 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 	{
 		for(int i=0;i<l;i++)
 			alpha_[active_set[i]] = alpha[i];
+		if(G_out != NULL)
+			for(int i=0;i<l;i++)
+				G_out[active_set[i]] = G[i];
 	}
 
 	// juggle everything back
@@ -1397,6 +1547,7 @@ public:
 		int start, j;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
+#pragma omp parallel for schedule(static) if(fill_in_parallel(len-start))
 			for(j=start;j<len;j++)
 				data[j] = (Qfloat)(y[i]*y[j]*(this->*kernel_function)(i,j));
 		}
@@ -1446,6 +1597,7 @@ public:
 		int start, j;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
+#pragma omp parallel for schedule(static) if(fill_in_parallel(len-start))
 			for(j=start;j<len;j++)
 				data[j] = (Qfloat)(this->*kernel_function)(i,j);
 		}
@@ -1552,9 +1704,15 @@ private:
 //
 // construct and solve various formulations
 //
+//
+// init_alpha: the starting point (warm start), or NULL to start from 0
+// G: the gradient matching init_alpha (or NULL to compute it), receives
+// the final gradient
+//
 static void solve_c_svc(
 	const svm_problem *prob, const svm_parameter* param,
-	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn)
+	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn,
+	const double *init_alpha = NULL, double *G = NULL)
 {
 	int l = prob->l;
 	double *minus_ones = new double[l];
@@ -1569,9 +1727,36 @@ static void solve_c_svc(
 		if(prob->y[i] > 0) y[i] = +1; else y[i] = -1;
 	}
 
+	bool warm_G = (init_alpha != NULL && G != NULL);
+	if(init_alpha != NULL)
+	{
+		// clip the alphas to the box [0, C]; if some are clipped, balance
+		// them so that y'alpha = 0 again and recompute the gradient
+		double sum_p = 0, sum_n = 0;
+		for(i=0;i<l;i++)
+		{
+			double C_i = (y[i] > 0) ? Cp : Cn;
+			double alpha_i = init_alpha[i];
+			if(fabs(alpha_i - C_i) <= 1e-12*C_i)
+				alpha_i = C_i;	// a bounded alpha (rounding)
+			alpha[i] = min(max(alpha_i,0.0),C_i);
+			if(alpha[i] != alpha_i)
+				warm_G = false;
+			if(y[i] > 0) sum_p += alpha[i]; else sum_n += alpha[i];
+		}
+		if(!warm_G && sum_p != sum_n)
+		{
+			double scale_p = (sum_p > sum_n) ? sum_n/sum_p : 1;
+			double scale_n = (sum_n > sum_p) ? sum_p/sum_n : 1;
+			for(i=0;i<l;i++)
+				alpha[i] *= (y[i] > 0) ? scale_p : scale_n;
+		}
+	}
+
 	Solver s;
 	s.Solve(l, SVC_Q(*prob,*param,y), minus_ones, y,
-		alpha, Cp, Cn, param->eps, si, param->shrinking);
+		alpha, Cp, Cn, param->eps, si, param->shrinking,
+		warm_G ? G : NULL, G);
 
 	double sum_alpha=0;
 	for(i=0;i<l;i++)
@@ -1761,14 +1946,15 @@ struct decision_function
 
 static decision_function svm_train_one(
 	const svm_problem *prob, const svm_parameter *param,
-	double Cp, double Cn)
+	double Cp, double Cn,
+	const double *init_alpha = NULL, double *G = NULL)	// C_SVC only
 {
 	double *alpha = Malloc(double,prob->l);
 	Solver::SolutionInfo si;
 	switch(param->svm_type)
 	{
 		case C_SVC:
-			solve_c_svc(prob,param,alpha,&si,Cp,Cn);
+			solve_c_svc(prob,param,alpha,&si,Cp,Cn,init_alpha,G);
 			break;
 		case NU_SVC:
 			solve_nu_svc(prob,param,alpha,&si);
@@ -2205,10 +2391,27 @@ static void svm_group_classes(const svm_problem *prob, int *nr_class_ret, int **
 // Interface functions
 //
 svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
+{
+	return svm_train_warm(prob,param,NULL,NULL);
+}
+
+//
+// Warm start of a two-class C_SVC (ignored otherwise). alpha and G (in the
+// order of prob) are a solution and its gradient divided by their C:
+// alpha/C and (G+1)/C = Q.alpha/C (cold start: 0 and 0; G may be NULL to
+// compute it). The starting point is C times alpha (clipped to the box if
+// the weights changed), so that the bounded alphas of the previous C stay
+// at the bound. They receive the solution, so that the SVMs of a C path are
+// each trained from the previous solution.
+//
+svm_model *svm_train_warm(const svm_problem *prob, const svm_parameter *param,
+			  double *alpha, double *G)
 {
 	svm_model *model = Malloc(svm_model,1);
 	model->param = *param;
 	model->free_sv = 0;	// XXX
+	model->SV_dense = NULL;
+	model->dense_dim = 0;
 
 	if(param->svm_type == ONE_CLASS ||
 	   param->svm_type == EPSILON_SVR ||
@@ -2329,7 +2532,33 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
 				if(param->probability)
 					svm_binary_svc_probability(&sub_prob,param,weighted_C[i],weighted_C[j],probA[p],probB[p]);
 
-				f[p] = svm_train_one(&sub_prob,param,weighted_C[i],weighted_C[j]);
+				// with two classes sub_prob is prob in the order of perm
+				double *sub_alpha = NULL, *sub_G = NULL;
+				if(alpha != NULL && nr_class == 2 && param->svm_type == C_SVC)
+				{
+					sub_alpha = Malloc(double,sub_prob.l);
+					if(G != NULL)
+						sub_G = Malloc(double,sub_prob.l);
+					for(k=0;k<sub_prob.l;k++)
+					{
+						sub_alpha[k] = param->C*alpha[perm[k]];
+						if(G != NULL)
+							sub_G[k] = param->C*G[perm[k]] - 1;
+					}
+				}
+
+				f[p] = svm_train_one(&sub_prob,param,weighted_C[i],weighted_C[j],sub_alpha,sub_G);
+				if(sub_alpha != NULL)
+				{
+					for(k=0;k<sub_prob.l;k++)
+					{
+						alpha[perm[k]] = fabs(f[p].alpha[k])/param->C;
+						if(G != NULL)
+							G[perm[k]] = (sub_G[k] + 1)/param->C;
+					}
+					free(sub_alpha);
+					free(sub_G);
+				}
 				for(k=0;k<ci;k++)
 					if(!nonzero[si+k] && fabs(f[p].alpha[k]) > 0)
 						nonzero[si+k] = true;
@@ -2447,6 +2676,7 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
 		free(nz_count);
 		free(nz_start);
 	}
+	svm_build_dense_sv(model);
 	return model;
 }
 
@@ -2613,6 +2843,57 @@ double svm_get_svr_probability(const svm_model *model)
 	}
 }
 
+// dense copy of the SVs of a CHIS or INTERS model (see Kernel)
+void svm_build_dense_sv(svm_model *model)
+{
+	model->SV_dense = NULL;
+	model->dense_dim = 0;
+	if(!dense_kernel(model->param.kernel_type) || model->l == 0)
+		return;
+	int dim = dense_dimension(model->SV,model->l);
+	if(dim == 0)
+		return;
+	model->SV_dense = Malloc(float,(size_t)model->l*dim);
+	for(int i=0;i<model->l;i++)
+		dense_row(model->SV[i],model->SV_dense+(size_t)i*dim,dim);
+	model->dense_dim = dim;
+}
+
+double svm_k_function(const svm_node *x, const svm_node *y, const svm_parameter *param)
+{
+	return Kernel::k_function(x,y,*param);
+}
+
+double svm_k_base(const svm_node *x, const svm_node *y, const svm_parameter *param)
+{
+	return Kernel::k_base(x,y,*param);
+}
+
+// kernel values between x and the SVs, on the dense rows when x fits in them
+//
+// row: dense_dim floats for the dense row of x, or NULL to allocate them
+//
+void svm_kernel_values(const svm_model *model, const svm_node *x, double *kvalue, float *row)
+{
+	int l = model->l;
+	if(model->SV_dense != NULL)
+	{
+		int dim = model->dense_dim;
+		float *buffer = (row != NULL) ? row : Malloc(float,dim);
+		bool fits = dense_row(x,buffer,dim);
+		if(fits)
+			for(int i=0;i<l;i++)
+				kvalue[i] = dense_k_function(buffer,model->SV_dense+(size_t)i*dim,dim,
+							     model->param.kernel_type);
+		if(row == NULL)
+			free(buffer);
+		if(fits)
+			return;
+	}
+	for(int i=0;i<l;i++)
+		kvalue[i] = Kernel::k_function(x,model->SV[i],model->param);
+}
+
 double svm_predict_values(const svm_model *model, const svm_node *x, double* dec_values)
 {
 	int i;
@@ -2622,8 +2903,11 @@ double svm_predict_values(const svm_model *model, const svm_node *x, double* dec
 	{
 		double *sv_coef = model->sv_coef[0];
 		double sum = 0;
+		double *kvalue = Malloc(double,model->l);
+		svm_kernel_values(model,x,kvalue,NULL);
 		for(i=0;i<model->l;i++)
-			sum += sv_coef[i] * Kernel::k_function(x,model->SV[i],model->param);
+			sum += sv_coef[i] * kvalue[i];
+		free(kvalue);
 		sum -= model->rho[0];
 		*dec_values = sum;
 
@@ -2638,8 +2922,7 @@ double svm_predict_values(const svm_model *model, const svm_node *x, double* dec
 		int l = model->l;
 		
 		double *kvalue = Malloc(double,l);
-		for(i=0;i<l;i++)
-			kvalue[i] = Kernel::k_function(x,model->SV[i],model->param);
+		svm_kernel_values(model,x,kvalue,NULL);
 
 		int *start = Malloc(int,nr_class);
 		start[0] = 0;
@@ -2889,6 +3172,8 @@ svm_model *svm_load_model(const char *model_file_name)
 	model->sv_indices = NULL;
 	model->label = NULL;
 	model->nSV = NULL;
+	model->SV_dense = NULL;
+	model->dense_dim = 0;
 
 	char cmd[81];
 	while(1)
@@ -3086,6 +3371,7 @@ svm_model *svm_load_model(const char *model_file_name)
 		return NULL;
 
 	model->free_sv = 1;	// XXX
+	svm_build_dense_sv(model);
 	return model;
 }
 
@@ -3122,6 +3408,10 @@ void svm_free_model_content(svm_model* model_ptr)
 
 	free(model_ptr->nSV);
 	model_ptr->nSV = NULL;
+
+	free(model_ptr->SV_dense);
+	model_ptr->SV_dense = NULL;
+	model_ptr->dense_dim = 0;
 }
 
 void svm_free_and_destroy_model(svm_model** model_ptr_ptr)
@@ -3176,6 +3466,9 @@ const char *svm_check_parameter(const svm_problem *prob, const svm_parameter *pa
 	if(param->cache_size <= 0)
 		return "cache_size <= 0";
 
+	if(param->parallel_fill < 0)
+		return "parallel_fill < 0";
+
 	if(param->eps <= 0)
 		return "eps <= 0";
 
@@ -79,6 +79,22 @@ void IMbdd::write_bdd_configuration(std::string pFolder,
   kFile->SetAttribute("path",(this->KMeansFile).c_str());  
   centers->LinkEndChild(kFile);
 
+  // PCA
+  TiXmlElement* pca = new TiXmlElement("PCA");
+  pca->SetAttribute("dim",this->pcaDim);
+  pca->SetAttribute("path",(this->pcaFile).c_str());
+  root->LinkEndChild(pca);
+  
+  // Coreset
+  TiXmlElement* coreset = new TiXmlElement("Coreset");
+  coreset->SetAttribute("size",this->coresetSize);
+  root->LinkEndChild(coreset);
+  
+  // Reservoir
+  TiXmlElement* reservoir = new TiXmlElement("Reservoir");
+  reservoir->SetAttribute("size",this->reservoirSize);
+  root->LinkEndChild(reservoir);
+  
   // Normalization
   TiXmlElement* normalization = new TiXmlElement("Normalization");
   normalization->SetAttribute("type",(this->normalization).c_str());
@@ -109,6 +125,11 @@ void IMbdd::write_bdd_configuration(std::string pFolder,
     models->LinkEndChild(model);
   }
   
+  TiXmlElement* linear = new TiXmlElement("Linear");
+  linear->SetAttribute("order",this->mapOrder);
+  linear->SetAttribute("approximate",this->approxPrediction ? 1 : 0);
+  svm->LinkEndChild(linear);
+  
   //dump_to_stdout( &doc );
   std::string savePath(pFolder + "/" + pFilename);
   doc.SaveFile(savePath.c_str());  
@@ -161,6 +182,23 @@ void IMbdd::load_bdd_configuration(std::string pFolder, std::string pFilename){
   pElem = pElem->NextSiblingElement();
   this->KMeansFile = pElem->Attribute("path");
   
+  // PCA (older configurations have none)
+  pElem = hRoot.FirstChild("PCA").Element();
+  if(pElem){
+    pElem->QueryIntAttribute("dim",&this->pcaDim);
+    this->pcaFile = pElem->Attribute("path");
+  }
+  
+  // Coreset (older configurations have none)
+  pElem = hRoot.FirstChild("Coreset").Element();
+  if(pElem)
+    pElem->QueryIntAttribute("size",&this->coresetSize);
+  
+  // Reservoir (older configurations have none)
+  pElem = hRoot.FirstChild("Reservoir").Element();
+  if(pElem)
+    pElem->QueryIntAttribute("size",&this->reservoirSize);
+  
   // Normalization
   pElem = hRoot.FirstChild("Normalization").Element();
   this->normalization = pElem->Attribute("type");
@@ -175,6 +213,15 @@ void IMbdd::load_bdd_configuration(std::string pFolder, std::string pFilename){
   pElem = hRoot.FirstChild("SVM").FirstChild("Models").FirstChild().Element(); 
   for(pElem; pElem; pElem=pElem->NextSiblingElement())
     this->modelFiles.push_back(pElem->Attribute("path"));
+  
+  // Linear models (older configurations have none)
+  pElem = hRoot.FirstChild("SVM").FirstChild("Linear").Element();
+  if(pElem){
+    pElem->QueryIntAttribute("order",&this->mapOrder);
+    int approximate = 0;
+    pElem->QueryIntAttribute("approximate",&approximate);
+    this->approxPrediction = (approximate != 0);
+  }
 }
 void IMbdd::show_bdd_configuration(){
   std::cout << "BDD: " << bddName << " (in "<< folder << ")" << std::endl;
@@ -187,9 +234,30 @@ void IMbdd::show_bdd_configuration(){
   std::cout << "\t - Algorithm: " << km_algorithm << std::endl;
   std::cout << "\t - Number of means: " << k << std::endl;
   std::cout << "\t - File to the means: " << KMeansFile << std::endl;
+  std::cout << "# PCA" << std::endl;
+  if(pcaDim > 0)
+    std::cout << "\t - Dimension: " << pcaDim << " (" << pcaFile << ")" << std::endl;
+  else
+    std::cout << "\t - None" << std::endl;
+  std::cout << "# Coreset" << std::endl;
+  if(coresetSize > 0)
+    std::cout << "\t - Size: " << coresetSize << std::endl;
+  else
+    std::cout << "\t - None" << std::endl;
+  std::cout << "# Reservoir" << std::endl;
+  if(reservoirSize > 0)
+    std::cout << "\t - Size: " << reservoirSize << std::endl;
+  else
+    std::cout << "\t - None (maxPts per file)" << std::endl;
   std::cout << "# Normalization" << std::endl;
   std::cout << "\t - Normalization used: " << normalization << std::endl;
   std::cout << "# SVM" << std::endl;
+  if(mapOrder > 0)
+    std::cout << "\t - Linear models (feature map of order " << mapOrder << ")" << std::endl;
+  else if(approxPrediction)
+    std::cout << "\t - Kernel models, predicted by their linear approximation" << std::endl;
+  else
+    std::cout << "\t - Kernel models" << std::endl;
 }
 void IMbdd::saveName(std::string bddName){this->bddName = bddName;};
 void IMbdd::changeDataSettings(std::vector<std::string> activities,
@@ -214,6 +282,17 @@ void IMbdd::changeKMSettings(std::string algorithm,
   this->k = k;
   this->KMeansFile = KMeansFile;
 }
+void IMbdd::changePCASettings(int pcaDim,
+			      std::string pcaFile){
+  this->pcaDim = pcaDim;
+  this->pcaFile = pcaFile;
+}
+void IMbdd::changeCoresetSettings(int coresetSize){
+  this->coresetSize = coresetSize;
+}
+void IMbdd::changeReservoirSettings(int reservoirSize){
+  this->reservoirSize = reservoirSize;
+}
 void IMbdd::changeNormalizationSettings(std::string normalization,
 					std::string meansFile,
 					std::string standardDeviationFile){
@@ -226,6 +305,12 @@ void IMbdd::changeSVMSettings(int nr_class,
   this->nr_class = nr_class;
   this->modelFiles = modelFiles;
 }
+void IMbdd::changeLinearSettings(int mapOrder){
+  this->mapOrder = mapOrder;
+}
+void IMbdd::changeApproxSettings(bool approxPrediction){
+  this->approxPrediction = approxPrediction;
+}
 IMbdd::IMbdd(std::string bddName, std::string folder){
   this->bddName = bddName;
   this->folder = folder;
@@ -244,6 +329,16 @@ IMbdd::IMbdd(std::string bddName, std::string folder){
   this->k = -1;
   this->KMeansFile = "";
   
+  // PCA
+  this->pcaDim = 0;
+  this->pcaFile = "";
+  
+  // Coreset
+  this->coresetSize = 0;
+  
+  // Reservoir
+  this->reservoirSize = 0;
+  
   // Normalization
   this->normalization = "";
   this->meansFile = "";
@@ -251,4 +346,6 @@ IMbdd::IMbdd(std::string bddName, std::string folder){
   
   // SVM
   this->nr_class = -1;
+  this->mapOrder = 0;
+  this->approxPrediction = false;
 }
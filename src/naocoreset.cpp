@@ -0,0 +1,350 @@
+/**
+ * \file naocoreset.cpp
+ * \brief Summaries of the descriptors of an activity for the k-means:
+ * weighted coresets (streaming merge-and-reduce with sensitivity sampling)
+ * and uniform samples (reservoir sampling).
+ * \author agent
+ * \date 19/10/2026
+ *
+ */
+#include "naocoreset.h"
+#include <algorithm> // upper_bound
+#include <math.h>
+
+/**
+ * \fn static int kmDrawIndex(int n, const double* p, double total)
+ * \brief Draws an index i in [0, n-1] with probability p[i]/total.
+ */
+static int kmDrawIndex(int n, const double* p, double total){
+  double r = kmRanUnif(0, total);
+  double cumul = 0;
+  for(int i=0 ; i<n ; i++){
+    cumul += p[i];
+    if(r < cumul)
+      return i;
+  }
+  // rounding: the last point of non-zero probability
+  int i = n - 1;
+  while(i > 0 && p[i] <= 0) i--;
+  return i;
+}
+
+/**
+ * \fn void kmWeightedSeeding(const KMdata& dataPts, const double* weights, int k, KMpointArray ctrs, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Weighted k-means++ seeding (D^2 sampling): the first center is
+ * drawn proportionally to the weights, each next one proportionally to the
+ * weight times the squared distance to the closest center already drawn.
+ *
+ * \param[in] dataPts The points.
+ * \param[in] weights Their weights (NULL: all the points weigh 1).
+ * \param[in] k The number of centers (at most the number of points).
+ * \param[out] ctrs The k centers.
+ * \param[out] closeCtr If not NULL, the closest center of each point.
+ * \param[out] sqDist If not NULL, the squared distance of each point to
+ * its closest center.
+ */
+void kmWeightedSeeding(const KMdata& dataPts, const double* weights, int k,
+		       KMpointArray ctrs, KMctrIdxArray closeCtr,
+		       double* sqDist){
+  int nPts = dataPts.getNPts();
+  int dim = dataPts.getDim();
+  double* w = new double[nPts];
+  double* d2 = new double[nPts];
+  double* p = new double[nPts];
+  int* assignment = new int[nPts];
+  double totalWeight = 0;
+  for(int i=0 ; i<nPts ; i++){
+    w[i] = weights ? weights[i] : 1;
+    totalWeight += w[i];
+    d2[i] = -1; // no center yet
+    assignment[i] = 0;
+  }
+
+  int chosen = kmDrawIndex(nPts, w, totalWeight);
+  for(int c=0 ; c<k ; c++){
+    for(int d=0 ; d<dim ; d++)
+      ctrs[c][d] = dataPts[chosen][d];
+    double total = 0;
+#pragma omp parallel for schedule(static) reduction(+:total) if(nPts > 10000)
+    for(int i=0 ; i<nPts ; i++){
+      double dist = 0;
+      for(int d=0 ; d<dim ; d++){
+	double diff = dataPts[i][d] - ctrs[c][d];
+	dist += diff*diff;
+      }
+      if(d2[i] < 0 || dist < d2[i]){
+	d2[i] = dist;
+	assignment[i] = c;
+      }
+      p[i] = w[i]*d2[i];
+      total += p[i];
+    }
+    if(c+1 < k) // all the points may already be centers
+      chosen = (total > 0) ? kmDrawIndex(nPts, p, total) : kmDrawIndex(nPts, w, totalWeight);
+  }
+
+  for(int i=0 ; i<nPts ; i++){
+    if(closeCtr) closeCtr[i] = assignment[i];
+    if(sqDist) sqDist[i] = d2[i];
+  }
+  delete[] w;
+  delete[] d2;
+  delete[] p;
+  delete[] assignment;
+}
+
+/**
+ * \fn KMcoreset::KMcoreset(int dim, int size, int nrSeeds)
+ * \brief An empty coreset.
+ *
+ * \param[in] dim The dimension of the descriptors.
+ * \param[in] size The number of weighted points of the coreset.
+ * \param[in] nrSeeds The number of seeds of the bicriteria solutions (about
+ * the number of clusters looked for, at most KM_CORESET_MAX_SEEDS is enough).
+ */
+KMcoreset::KMcoreset(int dim, int size, int nrSeeds) :
+  dim(dim), size(size), nrSeeds(nrSeeds), nrDescriptors(0),
+  nPts(0), pts(NULL), weights(NULL){
+  if(size < nrSeeds || nrSeeds < 1){
+    std::cerr << "Bad coreset size: " << size << " (" << nrSeeds << " seeds)" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+KMcoreset::~KMcoreset(){
+  delete pts;
+  delete[] weights;
+}
+
+/**
+ * \fn void KMcoreset::push(const double* x, double w)
+ * \brief Buffers one weighted point: a full buffer becomes a bucket.
+ */
+void KMcoreset::push(const double* x, double w){
+  if(pts){
+    std::cerr << "The coreset is already finished!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  buffer.x.insert(buffer.x.end(), x, x + dim);
+  buffer.w.push_back(w);
+  if(buffer.n() == size)
+    carry(buffer);
+}
+
+/**
+ * \fn void KMcoreset::carry(KMbucket& bucket)
+ * \brief Puts a bucket at level 0: while the level is occupied both
+ * buckets are merged, reduced, and go up one level. The bucket is emptied.
+ */
+void KMcoreset::carry(KMbucket& bucket){
+  unsigned int l = 0;
+  while(l < levels.size() && levels[l].n() > 0){
+    bucket.x.insert(bucket.x.end(), levels[l].x.begin(), levels[l].x.end());
+    bucket.w.insert(bucket.w.end(), levels[l].w.begin(), levels[l].w.end());
+    levels[l].clear();
+    reduce(bucket);
+    l++;
+  }
+  if(l == levels.size())
+    levels.push_back(KMbucket());
+  levels[l].x.swap(bucket.x);
+  levels[l].w.swap(bucket.w);
+  bucket.clear();
+}
+
+/**
+ * \fn void KMcoreset::reduce(KMbucket& bucket)
+ * \brief Replaces the points of the bucket by size weighted points drawn
+ * by sensitivity sampling (nothing is done if there are less points).
+ */
+void KMcoreset::reduce(KMbucket& bucket) const{
+  int n = bucket.n();
+  if(n <= size)
+    return;
+
+  // Bicriteria solution
+  KMdata data(dim, n);
+  for(int i=0 ; i<n ; i++)
+    for(int d=0 ; d<dim ; d++)
+      data[i][d] = bucket.x[i*dim + d];
+  int k = (nrSeeds < n) ? nrSeeds : n;
+  KMpointArray seeds = kmAllocPts(k, dim);
+  KMctrIdxArray closeCtr = new KMctrIdx[n];
+  double* d2 = new double[n];
+  kmWeightedSeeding(data, &bucket.w[0], k, seeds, closeCtr, d2);
+  kmDeallocPts(seeds);
+
+  // Weight and cost of each cluster
+  std::vector<double> clusterWeight(k, 0), clusterCost(k, 0);
+  double totalWeight = 0, cost = 0;
+  for(int i=0 ; i<n ; i++){
+    clusterWeight[closeCtr[i]] += bucket.w[i];
+    clusterCost[closeCtr[i]] += bucket.w[i]*d2[i];
+    totalWeight += bucket.w[i];
+    cost += bucket.w[i]*d2[i];
+  }
+
+  // Upper bounds of the sensitivities
+  double alpha = 16*(log((double) k) + 2);
+  double meanCost = cost/totalWeight;
+  std::vector<double> cumul(n);
+  double total = 0;
+  for(int i=0 ; i<n ; i++){
+    int c = closeCtr[i];
+    double s = 4*totalWeight/clusterWeight[c];
+    if(meanCost > 0)
+      s += alpha*d2[i]/meanCost + 2*alpha*clusterCost[c]/(clusterWeight[c]*meanCost);
+    total += bucket.w[i]*s;
+    cumul[i] = total;
+  }
+  delete[] closeCtr;
+  delete[] d2;
+
+  // Sampling size points (with replacement): a point drawn m times with
+  // probability q weighs m*w/(size*q)
+  std::vector<int> count(n, 0);
+  for(int j=0 ; j<size ; j++){
+    int i = std::upper_bound(cumul.begin(), cumul.end(), kmRanUnif(0, total)) - cumul.begin();
+    count[(i < n) ? i : n-1]++;
+  }
+  KMbucket sample;
+  for(int i=0 ; i<n ; i++){
+    if(count[i] > 0){
+      double q = (cumul[i] - ((i > 0) ? cumul[i-1] : 0))/total;
+      sample.x.insert(sample.x.end(), bucket.x.begin() + i*dim, bucket.x.begin() + (i+1)*dim);
+      sample.w.push_back(count[i]/(size*q)*bucket.w[i]);
+    }
+  }
+  bucket.x.swap(sample.x);
+  bucket.w.swap(sample.w);
+}
+
+/**
+ * \fn void KMcoreset::add(const KMdata& dataPts)
+ * \brief Adds a block of descriptors (of weight 1) to the stream.
+ */
+void KMcoreset::add(const KMdata& dataPts){
+  for(int i=0 ; i<dataPts.getNPts() ; i++)
+    push(dataPts[i], 1);
+  nrDescriptors += dataPts.getNPts();
+}
+
+/**
+ * \fn void KMcoreset::add(const KMcoreset& coreset)
+ * \brief Adds the weighted points of a finished coreset to the stream.
+ */
+void KMcoreset::add(const KMcoreset& coreset){
+  for(int i=0 ; i<coreset.getNPts() ; i++)
+    push((*coreset.pts)[i], coreset.weights[i]);
+  nrDescriptors += coreset.nrDescriptors;
+}
+
+/**
+ * \fn void KMcoreset::finish()
+ * \brief Merges the buckets and reduces them to the final coreset
+ * (getPts and getWeights). No descriptor can be added afterwards.
+ */
+void KMcoreset::finish(){
+  KMbucket all;
+  all.x.swap(buffer.x);
+  all.w.swap(buffer.w);
+  for(unsigned int l=0 ; l<levels.size() ; l++){
+    all.x.insert(all.x.end(), levels[l].x.begin(), levels[l].x.end());
+    all.w.insert(all.w.end(), levels[l].w.begin(), levels[l].w.end());
+  }
+  levels.clear();
+  reduce(all);
+
+  nPts = all.n();
+  pts = new KMdata(dim, (nPts > 0) ? nPts : 1);
+  pts->setNPts(nPts);
+  weights = new double[(nPts > 0) ? nPts : 1];
+  for(int i=0 ; i<nPts ; i++){
+    for(int d=0 ; d<dim ; d++)
+      (*pts)[i][d] = all.x[i*dim + d];
+    weights[i] = all.w[i];
+  }
+}
+
+/**
+ * \fn KMreservoir::KMreservoir(int dim, int size)
+ * \brief An empty reservoir.
+ *
+ * \param[in] dim The dimension of the descriptors.
+ * \param[in] size The maximum number of descriptors of the sample.
+ */
+KMreservoir::KMreservoir(int dim, int size) :
+  dim(dim), size(size), nrDescriptors(0){
+  if(size < 1){
+    std::cerr << "Bad reservoir size: " << size << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  pts = new KMdata(dim, size);
+  pts->setNPts(0);
+}
+
+KMreservoir::~KMreservoir(){
+  delete pts;
+}
+
+/**
+ * \fn void KMreservoir::add(const KMdata& dataPts)
+ * \brief Adds a block of descriptors to the stream.
+ */
+void KMreservoir::add(const KMdata& dataPts){
+  for(int i=0 ; i<dataPts.getNPts() ; i++){
+    nrDescriptors++;
+    int n = pts->getNPts();
+    int slot;
+    if(n < size){
+      slot = n;
+      pts->setNPts(n + 1);
+    }
+    else{
+      double r = kmRanUnif(0, nrDescriptors);
+      if(r >= size)
+	continue;
+      slot = (int) r;
+    }
+    for(int d=0 ; d<dim ; d++)
+      (*pts)[slot][d] = dataPts[i][d];
+  }
+}
+
+/**
+ * \fn void KMreservoir::add(const KMreservoir& reservoir)
+ * \brief Merges the sample of another (disjoint) stream: the result is a
+ * uniform sample of the union of both streams.
+ *
+ * The descriptors are drawn one by one from one of both streams with a
+ * probability proportional to the number of its descriptors not drawn yet,
+ * and uniformly among its sample: both samples being uniform, any subset
+ * of the union is equally likely.
+ */
+void KMreservoir::add(const KMreservoir& reservoir){
+  const KMdata* samples[2] = { pts, reservoir.pts };
+  double remaining[2] = { nrDescriptors, reservoir.nrDescriptors };
+  int n[2] = { pts->getNPts(), reservoir.getNPts() };
+  int taken[2] = { 0, 0 };
+  std::vector<int> perm[2];
+  for(int s=0 ; s<2 ; s++)
+    for(int i=0 ; i<n[s] ; i++)
+      perm[s].push_back(i);
+
+  int m = (n[0] + n[1] < size) ? n[0] + n[1] : size;
+  KMdata* merged = new KMdata(dim, size);
+  merged->setNPts(m);
+  for(int j=0 ; j<m ; j++){
+    int s = (kmRanUnif(0, remaining[0] + remaining[1]) < remaining[0]) ? 0 : 1;
+    if(taken[s] == n[s]) s = 1 - s; // rounding
+    int i = taken[s] + kmRanInt(n[s] - taken[s]);
+    int tmp = perm[s][taken[s]]; perm[s][taken[s]] = perm[s][i]; perm[s][i] = tmp;
+    for(int d=0 ; d<dim ; d++)
+      (*merged)[j][d] = (*samples[s])[perm[s][taken[s]]][d];
+    taken[s]++;
+    remaining[s]--;
+  }
+  delete pts;
+  pts = merged;
+  nrDescriptors += reservoir.nrDescriptors;
+}
@@ -10,7 +10,7 @@
 #include <time.h>
 
 /**
- * \fn int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts)
+ * \fn int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts, int first)
  * \brief STIPs importation function in the format 1 point = 1 line.
  * Each dimension are separated from one space (" ").
  *
@@ -18,9 +18,11 @@
  * \param[in] dim The STIPs dimension.
  * \param[in] maxPts The maximum number of points you want to import.
  * \param[out] dataPts The KMlocal object which will be containing STIPs.
+ * \param[in] first The index of dataPts where the first point is stored
+ * (so that several files can be imported one after the other in the same pool).
  * \return Number of points imported.
  */
-int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts){
+int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts, int first){
   int nPts = 0; // actual number of points
 
   ifstream in(stip.c_str(), ios::in);	
@@ -34,7 +36,7 @@ int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts){
     // Saving each dimension
     int d = 0;
     while(!endOfLine && d < dim){
-      if(!(in >> (*dataPts)[nPts][d])){ // we save the stream in the buffer and 
+      if(!(in >> (*dataPts)[first + nPts][d])){ // we save the stream in the buffer and 
 	endOfLine = true; // if there is no more character it is because we are at the end of the line.
       }
       d++;
@@ -44,6 +46,33 @@ int importSTIPs(std::string stip, int dim, int maxPts, KMdata* dataPts){
   return nPts-1;
 }
 
+/**
+ * \fn int countSTIPs(std::string stip, int maxPts)
+ * \brief Gives the number of rows of dataPts that importSTIPs will use
+ * for this file, without parsing it (the lines are only counted).
+ *
+ * \param[in] stip Name of the file containing the STIPs.
+ * \param[in] maxPts The maximum number of points you want to import.
+ * \return The number of rows to reserve (at most maxPts).
+ */
+int countSTIPs(std::string stip, int maxPts){
+  ifstream in(stip.c_str(), ios::in | ios::binary);
+  if (!in){
+    cerr << "Pas de données à lire !!!" << endl;
+    exit(EXIT_FAILURE);
+  }
+  int nLines = 0;
+  char buffer[1 << 16];
+  while(in && nLines < maxPts){
+    in.read(buffer, sizeof(buffer));
+    std::streamsize n = in.gcount();
+    for(std::streamsize i=0 ; i<n ; i++)
+      if(buffer[i] == '\n') nLines++;
+  }
+  // importSTIPs touches the row following the last point
+  return (nLines + 1 < maxPts) ? nLines + 1 : maxPts;
+}
+
 /**
  * \fn void exportSTIPs(std::string stip, int dim, const KMdata& dataPts)
  * \brief STIPs exportation function in the format 1 point = 1 line.
@@ -82,6 +111,19 @@ void exportSTIPs(std::string stip, int dim, const KMdata& dataPts){
  * \param[in] ctrs The centers.
  */
 void exportCenters(std::string centers, int dim, int k, KMfilterCenters ctrs){
+  exportCenters(centers, dim, k, ctrs.getCtrPts());
+}
+
+/**
+ * \fn void exportCenters(std::string centers, int dim, int k, KMpointArray ctrs)
+ * \brief Export function to save centers which are not attached to a KMdata.
+ *
+ * \param[in] centers Name of the file which will be containing dimensions of each centers.
+ * \param[in] dim Center's dimension.
+ * \param[in] k Number of centers.
+ * \param[in] ctrs The centers.
+ */
+void exportCenters(std::string centers, int dim, int k, const KMpointArray ctrs){
   // ouverture en écriture avec effacement du fichier ouvert
   ofstream trainingMeans(centers.c_str(), ios::out | ios::trunc);
   if(!trainingMeans){
@@ -130,7 +172,83 @@ void importCenters(std::string centers, int dim, int k, KMfilterCenters* ctrs){
 }
 
 /**
- * \fn void kmIvanAlgorithm(int ic, int dim,  const KMdata& dataPts, int k, KMfilterCenters& ctrs)
+ * \fn void kmSampleIndices(int nPts, int sampleSize, int* indices)
+ * \brief Draws sampleSize distinct indices uniformly in [0, nPts-1].
+ *
+ * \param[in] nPts The number of points to sample from.
+ * \param[in] sampleSize The number of indices to draw (<= nPts).
+ * \param[out] indices An array of at least nPts integers. On return its
+ * first sampleSize elements are the sample.
+ *
+ * It is a partial Fisher-Yates shuffle: O(nPts) to initialize the
+ * permutation and O(sampleSize) to draw, without any rejection.
+ * Any prefix of the sample is itself a uniform sample.
+ */
+void kmSampleIndices(int nPts, int sampleSize, int* indices){
+  for(int i=0 ; i<nPts ; i++)
+    indices[i] = i;
+  for(int s=0 ; s<sampleSize ; s++){
+    int r = s + kmRanInt(nPts - s);
+    int tmp = indices[s];
+    indices[s] = indices[r];
+    indices[r] = tmp;
+  }
+}
+
+/**
+ * \fn double kmLloydStage(const KMdata& dataPts, KMcenters& ctrs, const double* weights)
+ * \brief One stage of Lloyd's algorithm (like KMfilterCenters::lloyd1Stage)
+ * with the batched assignment kernel of KMquantizer: the centers are moved
+ * to the (weighted) centroid of their points (a center without point does
+ * not move). No kc-tree is needed over dataPts.
+ *
+ * \param[in] dataPts The data.
+ * \param[in,out] ctrs The centers.
+ * \param[in] weights The weights of the points (NULL: they all weigh 1).
+ * \return The distortion of the assignment (before moving the centers).
+ */
+double kmLloydStage(const KMdata& dataPts, KMcenters& ctrs, const double* weights){
+  int nPts = dataPts.getNPts();
+  int dim = dataPts.getDim();
+  int k = ctrs.getK();
+  
+  KMquantizer quantizer(dim, k, ctrs.getCtrPts());
+  KMctrIdxArray closeCtr = new KMctrIdx[nPts];
+  double* sqDist = new double[nPts];
+  quantizer.getAssignments(dataPts, closeCtr, sqDist);
+  
+  KMpointArray sums = kmAllocPts(k, dim);
+  double* ctrWeights = new double[k];
+  for(int c=0 ; c<k ; c++){
+    ctrWeights[c] = 0;
+    for(int d=0 ; d<dim ; d++)
+      sums[c][d] = 0;
+  }
+  double distortion = 0;
+  for(int i=0 ; i<nPts ; i++){
+    int c = closeCtr[i];
+    double w = weights ? weights[i] : 1;
+    ctrWeights[c] += w;
+    for(int d=0 ; d<dim ; d++)
+      sums[c][d] += w*dataPts[i][d];
+    distortion += w*sqDist[i];
+  }
+  for(int c=0 ; c<k ; c++){
+    if(ctrWeights[c] > 0){
+      for(int d=0 ; d<dim ; d++)
+	ctrs[c][d] = sums[c][d]/ctrWeights[c];
+    }
+  }
+  
+  kmDeallocPts(sums);
+  delete[] ctrWeights;
+  delete[] closeCtr;
+  delete[] sqDist;
+  return distortion;
+}
+
+/**
+ * \fn void kmIvanAlgorithm(int ic, int dim, KMdata& dataPts, int k, KMcenters& ctrs)
  * \brief This is an optimized KMeans algorithm. Ivan's algorithm uses
  * basic KMeans algorithm (here the Lloyd's one) and the idea was to 
  * initialize centers intelligently.
@@ -139,7 +257,7 @@ void importCenters(std::string centers, int dim, int k, KMfilterCenters* ctrs){
  * \param[in] dim Points and centers's dimension.
  * \param[in] dataPts The data we want to compute the centers.
  * \param[in] k The number of centers.
- * \param[out] ctrs The centers.
+ * \param[out] ctrs The centers (allocated on dataPts).
  *
  * The Ivan's algorithm is divided into 3 phases. The first phase is executed on
  * 25 per cent of the data (randomly sampled). To begin, the centers are randomly generated.
@@ -148,12 +266,20 @@ void importCenters(std::string centers, int dim, int k, KMfilterCenters* ctrs){
  * This step is computed ic * 2 times.
  * Finally, we make ic * 1 iteration on all the data.
  *
+ * The samples are views over dataPts (see KMdata), so no descriptor is copied:
+ * one shuffle of the indices gives the 50 per cent sample and its first half
+ * is the 25 per cent sample. The stages are done by kmLloydStage, so no
+ * kc-tree has to be built over dataPts nor over the samples (ctrs may be a
+ * plain KMcenters).
+ *
+ * The random numbers come from the KMlocal generator of the calling thread
+ * (see KMrand.h): set kmIdum to a negative seed before calling. Several
+ * calls can run concurrently on different threads.
  */
-void kmIvanAlgorithm(int ic, int dim,  const KMdata& dataPts, int k, KMfilterCenters& ctrs){
+void kmIvanAlgorithm(int ic, int dim, KMdata& dataPts, int k, KMcenters& ctrs){
   int nPts = dataPts.getNPts();
-  KMdata subDataPts(dim,nPts); // maxPts = nPts since subDataPts is a sample of dataPts
-
-  int* randomVector = NULL;
+  
+  int* randomVector = new int[nPts];
   
   double** centersBuffer = NULL;
   centersBuffer = (double **) malloc(k*sizeof(double*));
@@ -163,8 +289,8 @@ void kmIvanAlgorithm(int ic, int dim,  const KMdata& dataPts, int k, KMfilterCen
   
   // ic : iteration coefficient
   int nrPhases = 3;
+  kmSampleIndices(nPts, floor(nPts/2), randomVector);
   for(int i=0 ; i<nrPhases ; i++){
-    std::cerr<<"phase:"<<i<<std::endl;
     int maxIter = (int) pow(2,(nrPhases-1-i));
     int sampleSize = floor(nPts/maxIter);
     
@@ -178,86 +304,323 @@ void kmIvanAlgorithm(int ic, int dim,  const KMdata& dataPts, int k, KMfilterCen
       std::cout << "..." << endl;
       std::cout << "Initializing centroids by sampling..." << std::endl;
     }
-
+    
     if (i == nrPhases-1){
-      // Filling subDataPts
-      for(int s=0; s<nPts ; s++){
+      // The last phase works on all the data: ctrs is already allocated on it
+      for(int c = 0; c < k ; c++){
 	for(int d=0 ; d<dim ; d++){
-	  subDataPts[s][d] = dataPts[s][d];
+	  ctrs[c][d] = centersBuffer[c][d];
 	}
       }
-      subDataPts.setNPts(nPts);
+      for(int iteration = 0  ; iteration < ic*maxIter ; iteration++){
+	kmLloydStage(dataPts, ctrs);
+      }
     }
     else{
-      // Filling the random vector permiting to sampling "uniformly" (as more as we can) the data  
-      std::cerr<<"ok++"<<std::endl; 
-      randomVector = (int*) malloc(sampleSize * sizeof(int));
-      srand(time(NULL)); // initialisation of rand
-      for(int s=0; s<sampleSize ;s++){
-	int r = (int) rand()%(nPts);
-	int index = 0;
-	while(index<s && randomVector[index] != r){
-	  index++;
-	}
-	if(s==0 || randomVector[index] != r)
-	  randomVector[s] = r;
-	else{
-	  s--;
-	}
+      // The sample is a view over dataPts
+      KMdata subDataPts(dataPts, randomVector, sampleSize);
+      
+      // Allocate centers with subData
+      KMcenters newCtrs(k, subDataPts);
+      
+      // Initializing the centers (randomly for the first iteration)
+      if(i==0){
+	subDataPts.sampleCtrs(newCtrs.getCtrPts(), k, false);
       }
-      std::cerr<<"ok--"<<std::endl; 
-      // Filling subDataPts
-      for(int s=0; s<sampleSize ; s++){
-	for(int d=0 ; d<dim ; d++){
-	  subDataPts[s][d] = dataPts[randomVector[s]][d];
-	}
+      else{
+	for(int c = 0; c < k ; c++){
+	  for(int d=0 ; d<dim ; d++){
+	    (newCtrs)[c][d] = centersBuffer[c][d];
+	  }
+	} 
       }
-      subDataPts.setNPts(sampleSize);
-    }
-    subDataPts.buildKcTree();
-    
-    // Allocate centers with subData
-    KMfilterCenters newCtrs(k, subDataPts);
-    
-    // Initializing the centers (randomly for the first iteration)
-    if(i==0){
-      (newCtrs).genRandom(); 
-    }
-    else{
-      for(int c = 0; c < k ; c++){
-	for(int d=0 ; d<dim ; d++){
-	  (newCtrs)[c][d] = centersBuffer[c][d];
-	}
-      } 
-    }
-    for(int iteration = 0  ; iteration < ic*maxIter ; iteration++){ // ic : iteration coefficient
-      (newCtrs).lloyd1Stage();
-    }
-    
-    // Saving the old centers in centersBuffer
-    for(int c = 0; c < k ; c++){
-      for(int d=0 ; d<dim ; d++){
-	centersBuffer[c][d] = (newCtrs)[c][d];
+      for(int iteration = 0  ; iteration < ic*maxIter ; iteration++){ // ic : iteration coefficient
+	kmLloydStage(subDataPts, newCtrs);
       }
-    }
-    
-    if(i==nrPhases-1){
+      
+      // Saving the old centers in centersBuffer
       for(int c = 0; c < k ; c++){
 	for(int d=0 ; d<dim ; d++){
-	  ctrs[c][d] = centersBuffer[c][d];
+	  centersBuffer[c][d] = (newCtrs)[c][d];
 	}
       }
     }
-    free(randomVector);
-    randomVector = NULL;
   }
-
+  delete[] randomVector;
+  
   for(int c=0 ; c<k ; c++){
     free(centersBuffer[c]);
   }
   free(centersBuffer);
 }
 
+/**
+ * \fn void kmWeightedAlgorithm(int ic, KMdata& dataPts, const double* weights, int k, KMcenters& ctrs)
+ * \brief K-means over weighted points (a coreset, see KMcoreset): the
+ * centers are initialized by a weighted k-means++ seeding, then ic*4
+ * stages of the weighted Lloyd's algorithm are done.
+ *
+ * \param[in] ic The iteration coefficient (as in kmIvanAlgorithm).
+ * \param[in] dataPts The points.
+ * \param[in] weights Their weights.
+ * \param[in] k The number of centers.
+ * \param[out] ctrs The centers (allocated on dataPts).
+ *
+ * A coreset is small enough for all the stages to run on all of it: there
+ * is no need of the sampling phases of kmIvanAlgorithm. The random numbers
+ * come from the generator of the calling thread (see kmIvanAlgorithm).
+ */
+void kmWeightedAlgorithm(int ic, KMdata& dataPts, const double* weights, int k, KMcenters& ctrs){
+  int nPts = dataPts.getNPts();
+  if(nPts < k){
+    std::cerr << "Not enough points (" << nPts << ") for " << k << " clusters!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Applying k-means: " << endl;
+  std::cout << "Clustering " << nPts << " weighted vectors in " << k << " clusters..." << std::endl;
+  kmWeightedSeeding(dataPts, weights, k, ctrs.getCtrPts());
+  for(int iteration = 0 ; iteration < ic*4 ; iteration++)
+    kmLloydStage(dataPts, ctrs, weights);
+}
+
+/**
+ * \fn void kmSplitCenters(int ic, const KMdata& dataPts, const double* weights, const KMcenters& from, KMcenters& to)
+ * \brief Grows a solution of the k-means into a solution with more centers
+ * by splitting its clusters (as in the LBG algorithm and the bisecting
+ * k-means): the cluster of highest distortion is split in two, its center
+ * c being replaced by c - u and c + u, where u has the standard deviation
+ * of the cluster along each dimension (with random signs), until to has
+ * all its centers. The halves are supposed to have half of the distortion
+ * of their cluster. Then ic stages of Lloyd's algorithm are
+ * done over all the points.
+ *
+ * \param[in] ic The iteration coefficient (as in kmIvanAlgorithm).
+ * \param[in] dataPts The points.
+ * \param[in] weights Their weights (NULL: they all weigh 1).
+ * \param[in] from The centers of the smaller solution.
+ * \param[out] to The centers (allocated on dataPts, with more centers than from).
+ *
+ * Since the clusters of from are already good, ic stages are enough where
+ * kmIvanAlgorithm needs sampling phases: a sequence of codebooks of
+ * increasing sizes is cheaper to grow than to compute from scratch. The
+ * random numbers come from the generator of the calling thread (see
+ * kmIvanAlgorithm).
+ */
+void kmSplitCenters(int ic, const KMdata& dataPts, const double* weights,
+		    const KMcenters& from, KMcenters& to){
+  int nPts = dataPts.getNPts();
+  int dim = dataPts.getDim();
+  int kFrom = from.getK();
+  int kTo = to.getK();
+  if(kTo < kFrom){
+    std::cerr << "Impossible to split " << kFrom << " centers into "
+	      << kTo << " centers!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Splitting " << kFrom << " clusters of " << nPts
+	    << " vectors into " << kTo << " clusters..." << std::endl;
+  
+  // The distortion and the variance of each cluster of from
+  KMquantizer quantizer(dim, kFrom, from.getCtrPts());
+  KMctrIdxArray closeCtr = new KMctrIdx[nPts];
+  double* sqDist = new double[nPts];
+  quantizer.getAssignments(dataPts, closeCtr, sqDist);
+  double* distortion = new double[kTo];
+  double* ctrWeights = new double[kFrom];
+  KMpointArray sqSums = kmAllocPts(kFrom, dim);
+  for(int c=0 ; c<kFrom ; c++){
+    distortion[c] = 0;
+    ctrWeights[c] = 0;
+    for(int d=0 ; d<dim ; d++)
+      sqSums[c][d] = 0;
+  }
+  for(int i=0 ; i<nPts ; i++){
+    int c = closeCtr[i];
+    double w = weights ? weights[i] : 1;
+    distortion[c] += w*sqDist[i];
+    ctrWeights[c] += w;
+    for(int d=0 ; d<dim ; d++){
+      double v = dataPts[i][d] - from[c][d];
+      sqSums[c][d] += w*v*v;
+    }
+  }
+  
+  for(int c=0 ; c<kFrom ; c++)
+    for(int d=0 ; d<dim ; d++)
+      to[c][d] = from[c][d];
+  // A split cluster of from may be split again: its halves keep the
+  // statistics of their parent, with a spread divided by sqrt(2) each time
+  int* parent = new int[kTo];
+  double* spread = new double[kTo];
+  for(int c=0 ; c<kFrom ; c++){
+    parent[c] = c;
+    spread[c] = 1;
+  }
+  for(int n=kFrom ; n<kTo ; n++){
+    int worst = 0;
+    for(int c=1 ; c<n ; c++)
+      if(distortion[c] > distortion[worst])
+	worst = c;
+    int p = parent[worst];
+    for(int d=0 ; d<dim ; d++){
+      double sigma = (ctrWeights[p] > 0) ? spread[worst]*sqrt(sqSums[p][d]/ctrWeights[p]) : 0;
+      double u = (kmRanInt(2) == 0) ? -sigma : sigma;
+      to[n][d] = to[worst][d] + u;
+      to[worst][d] -= u;
+    }
+    distortion[worst] /= 2;
+    spread[worst] /= sqrt(2.0);
+    distortion[n] = distortion[worst];
+    spread[n] = spread[worst];
+    parent[n] = p;
+  }
+  delete[] parent;
+  delete[] spread;
+  kmDeallocPts(sqSums);
+  delete[] ctrWeights;
+  delete[] distortion;
+  delete[] closeCtr;
+  delete[] sqDist;
+  
+  for(int iteration = 0 ; iteration < ic ; iteration++)
+    kmLloydStage(dataPts, to, weights);
+}
+
+/**
+ * \fn int kmStreamSTIPs(std::string stip, int dim, KMsummary& summary)
+ * \brief Adds all the STIPs of a file (same format as importSTIPs) to a
+ * summary (a coreset or a reservoir). The file is read by blocks of
+ * KM_STREAM_BLOCK descriptors, so the memory does not depend on the size
+ * of the file and nothing is truncated at maxPts.
+ *
+ * \param[in] stip Name of the file containing the STIPs.
+ * \param[in] dim The STIPs dimension.
+ * \param[in,out] summary The summary.
+ * \return The number of STIPs read.
+ */
+int kmStreamSTIPs(std::string stip, int dim, KMsummary& summary){
+  ifstream in(stip.c_str(), ios::in);
+  if (!in){
+    cerr << "Pas de données à lire !!!" << endl;
+    exit(EXIT_FAILURE);
+  }
+  KMdata block(dim, KM_STREAM_BLOCK);
+  int nPts = 0;
+  bool endOfFile = false;
+  while(!endOfFile){
+    int n = 0;
+    while(n < KM_STREAM_BLOCK && !endOfFile){
+      int d = 0;
+      while(d < dim && !(in >> block[n][d]).fail())
+	d++;
+      if(d < dim) // an incomplete line is the end of the file
+	endOfFile = true;
+      else
+	n++;
+    }
+    block.setNPts(n);
+    summary.add(block);
+    nPts += n;
+  }
+  return nPts;
+}
+
+/**
+ * \fn static void kmSplitNode(int ic, KMdata& dataPts, int* idx, int n, int node, int level, KMvocabularyTree& tree)
+ * \brief Clusters the points idx[0..n[ of the node in b clusters, whose
+ * centers become the node's children, then splits each child in turn.
+ */
+static void kmSplitNode(int ic, KMdata& dataPts, int* idx, int n,
+			int node, int level, KMvocabularyTree& tree){
+  int dim = dataPts.getDim();
+  int b = tree.getBranching();
+  int firstChild = node*b + 1;
+  
+  if(n < b){
+    // Not enough points: the children are the points themselves and the
+    // remaining ones are copies of the node (never closer than the points)
+    for(int c=0 ; c<b ; c++){
+      const double* src = (c < n) ? dataPts[idx[c]] : tree.getCenter(node);
+      double* dst = tree.getCenter(firstChild + c);
+      for(int d=0 ; d<dim ; d++)
+	dst[d] = src[d];
+    }
+  }
+  else{
+    KMdata nodePts(dataPts, idx, n);
+    KMcenters ctrs(b, nodePts);
+    nodePts.sampleCtrs(ctrs.getCtrPts(), b, false);
+    for(int iteration=0 ; iteration<ic*4 ; iteration++)
+      kmLloydStage(nodePts, ctrs);
+    for(int c=0 ; c<b ; c++)
+      for(int d=0 ; d<dim ; d++)
+	tree.getCenter(firstChild + c)[d] = ctrs[c][d];
+  }
+  if(level + 1 == tree.getDepth())
+    return;
+  
+  // Partitioning idx by child (counting sort) and going down
+  KMdata nodePts(dataPts, idx, n);
+  KMpointArray childCtrs = kmAllocPts(b, dim);
+  for(int c=0 ; c<b ; c++)
+    for(int d=0 ; d<dim ; d++)
+      childCtrs[c][d] = tree.getCenter(firstChild + c)[d];
+  KMquantizer quantizer(dim, b, childCtrs);
+  kmDeallocPts(childCtrs);
+  KMctrIdxArray closeCtr = new KMctrIdx[n];
+  quantizer.getAssignments(nodePts, closeCtr);
+  int* count = new int[b+1];
+  for(int c=0 ; c<=b ; c++)
+    count[c] = 0;
+  for(int i=0 ; i<n ; i++)
+    count[closeCtr[i]+1]++;
+  for(int c=0 ; c<b ; c++)
+    count[c+1] += count[c];
+  int* sorted = new int[n];
+  int* next = new int[b];
+  for(int c=0 ; c<b ; c++)
+    next[c] = count[c];
+  for(int i=0 ; i<n ; i++)
+    sorted[next[closeCtr[i]]++] = idx[i];
+  for(int i=0 ; i<n ; i++)
+    idx[i] = sorted[i];
+  delete[] sorted;
+  delete[] next;
+  delete[] closeCtr;
+  
+  for(int c=0 ; c<b ; c++)
+    kmSplitNode(ic, dataPts, idx + count[c], count[c+1] - count[c],
+		firstChild + c, level + 1, tree);
+  delete[] count;
+}
+
+/**
+ * \fn void kmVocabularyTree(int ic, KMdata& dataPts, KMvocabularyTree& tree)
+ * \brief Hierarchical k-means: the data is clustered in b clusters, then
+ * each cluster is clustered in b clusters with its own points, and so on
+ * until the depth of the tree.
+ *
+ * \param[in] ic The iteration coefficient: each node is clustered with
+ * ic*4 stages of Lloyd's algorithm from b sampled points.
+ * \param[in] dataPts The data.
+ * \param[in,out] tree The tree (allocated with its branching and depth).
+ *
+ * The random numbers come from the KMlocal generator of the calling thread
+ * (see KMrand.h).
+ */
+void kmVocabularyTree(int ic, KMdata& dataPts, KMvocabularyTree& tree){
+  int nPts = dataPts.getNPts();
+  int* idx = new int[nPts];
+  for(int i=0 ; i<nPts ; i++)
+    idx[i] = i;
+  std::cout << "Building a vocabulary tree of " << tree.getK() << " words (b="
+	    << tree.getBranching() << ", L=" << tree.getDepth() << ") with "
+	    << nPts << " vectors..." << std::endl;
+  kmSplitNode(ic, dataPts, idx, nPts, 0, 0, tree);
+  tree.updateNorms();
+  delete[] idx;
+}
+
 /**
  * \fn void createTrainingMeans(std::string stipFile, int dim, int maxPts, int k, std::string meansFile)
  * \brief Import HOG and HOF from a file and compute KMeans algorithm to create
@@ -279,13 +642,13 @@ void createTrainingMeans(std::string stipFile,
   KMdata dataPts(dim,maxPts);
   int nPts = importSTIPs(stipFile, dim, maxPts, &dataPts);
   dataPts.setNPts(nPts);
-  dataPts.buildKcTree();
   
-  KMfilterCenters ctrs(k, dataPts);    
+  KMcenters ctrs(k, dataPts);    
   
+  kmIdum = - (int) time(NULL); // (re)initialisation of the KMlocal generator
   int ic = 3;
   kmIvanAlgorithm(ic, dim, dataPts, k, ctrs);  
   
-  exportCenters(meansFile, dim, k, ctrs);
+  exportCenters(meansFile, dim, k, ctrs.getCtrPts());
 }
 
@@ -298,6 +298,19 @@ void deleteBdd(std::string bddName){
     i++;
   }
   delete []am;
+  // The folders fold_<person> left by an interrupted test or sweep
+  DIR* repertoire = opendir(path2bdd.c_str());
+  if(repertoire){
+    struct dirent * ent;
+    while ( (ent = readdir(repertoire)) != NULL){
+      std::string file = ent->d_name;
+      if(file.compare(0, 5, "fold_") == 0){
+	emptyFolder(path2bdd + "/" + file);
+	rmdir((path2bdd + "/" + file).c_str());
+      }
+    }
+    closedir(repertoire);
+  }
   emptyFolder(path2bdd);
   rmdir(path2bdd.c_str());
 }
@@ -451,6 +464,8 @@ void im_refresh_folder(const IMbdd& bdd, std::string folder){
 				    bdd.getActivities());
 }
 
+static std::string im_artifact_prefix(const IMbdd& bdd);
+
 /**
  * \fn void predictActivity(std::string, std::string bddName, int maxPts)
  * \brief Predict the activity done in a video with an existant trained BDD.
@@ -488,10 +503,18 @@ void predictActivity(std::string videoPath,
   }
   std::cout << nPts << " vectors extracted..." << std::endl;
   dataPts.setNPts(nPts);
-  dataPts.buildKcTree();
   
-  KMfilterCenters ctrs(k, dataPts);  
-  importCenters(bdd.getFolder() + "/" + bdd.getKMeansFile(), dim, k, &ctrs);
+  // The codebook may be built over the projected descriptors
+  KMpca* pca = im_load_pca(bdd);
+  KMdata* projected = NULL;
+  if(pca){
+    projected = new KMdata(pca->getOutDim(), nPts);
+    pca->project(dataPts, *projected);
+    delete pca;
+    std::cout << "Vectors projected..." << std::endl;
+  }
+  
+  KMcodebook* codebook = im_load_codebook(bdd);
   std::cout << "KMeans centers imported..." << std::endl;
   
   activitiesMap *am;
@@ -499,8 +522,10 @@ void predictActivity(std::string videoPath,
   
   
   struct svm_problem svmProblem = computeBOW(0,
-					     dataPts,
-					     ctrs);
+					     projected ? *projected : dataPts,
+					     *codebook);
+  delete codebook;
+  delete projected;
   double means[k], stand_devia[k];
   load_gaussian_parameters(bdd, means, stand_devia);
   // simple, gaussian, both, nothing
@@ -508,20 +533,40 @@ void predictActivity(std::string videoPath,
     bow_normalization(bdd,svmProblem);
   std::cout << "Bag of words normalized..." << std::endl;
   
-  struct svm_model** pSVMModels = new svm_model*[nbActivities];
-  std::vector<std::string> modelFiles(bdd.getModelFiles());
-  int i=0;
-  for (std::vector<std::string>::iterator it = modelFiles.begin() ; it != modelFiles.end() ; ++it){
-    pSVMModels[i]= svm_load_model((*it).c_str());
-    i++;
-  }
-  std::cout << "SVM models imported..." << std::endl;
+  // The linear models (trained on the feature map, see im_set_linear, or
+  // approximating the kernel models, see im_set_approximation) predict
+  // much faster than the kernel models
+  std::string linearFile(path2bdd + "/" + im_artifact_prefix(bdd) + "svm_ovr_linear.map");
   double probs[nbActivities];
-  double label = svm_predict_ovr_probs(pSVMModels,
-				       svmProblem.x[0],
-				       nbActivities,
-				       probs,
-				       2);
+  double label;
+  if(bdd.getMapOrder() > 0 ||
+     (bdd.getApproxPrediction() && std::ifstream(linearFile.c_str()))){
+    LinearOvrPredictor predictor(linearFile);
+    std::cout << "Linear models imported..." << std::endl;
+    label = svm_predict_ovr_probs(predictor,
+				  svmProblem.x[0],
+				  probs,
+				  2);
+  }
+  else{
+    struct svm_model** pSVMModels = new svm_model*[nbActivities];
+    std::vector<std::string> modelFiles(bdd.getModelFiles());
+    int i=0;
+    for (std::vector<std::string>::iterator it = modelFiles.begin() ; it != modelFiles.end() ; ++it){
+      pSVMModels[i]= svm_load_model((*it).c_str());
+      i++;
+    }
+    std::cout << "SVM models imported..." << std::endl;
+    OvrPredictor predictor(pSVMModels, nbActivities);
+    label = svm_predict_ovr_probs(predictor,
+				  svmProblem.x[0],
+				  probs,
+				  2);
+    for(int m=0 ; m<nbActivities ; m++){
+      svm_free_and_destroy_model(&pSVMModels[m]);
+    }
+    delete[] pSVMModels;
+  }
   std::cerr<<"Probs: ";
   for(int j=0 ; j<nbActivities ; j++){
     std::cout << setw(2) << setiosflags(ios::fixed) << probs[j]*100<<" "; 
@@ -532,10 +577,6 @@ void predictActivity(std::string videoPath,
   std::cout << "Activity predicted: ";
   std::cout << am[index].activity << "(" << am[index].label << ")";
   std::cout << std::endl;
-  
-  for(int m=0 ; m<nbActivities ; m++){
-    svm_free_and_destroy_model(&pSVMModels[m]);
-  }
 }
 
 #ifdef TRANSFER_TO_ROBOT_NAO
@@ -664,186 +705,691 @@ void im_concatenate_folder_feature_points(std::string folder,
   }
 }					
 
-int im_create_specifics_training_means(IMbdd bdd,
-				       const std::vector<std::string>& trainingPeople 
-				       //std::vector <std::string> rejects
-				       ){
-  std::string path2bdd(bdd.getFolder());
+/**
+ * \fn static std::string im_concatenate_file(const IMbdd& bdd, std::string person, std::string activity)
+ * \brief Gives the path of the file concatenate.<activity>.fp of a person
+ * (exits if there is none).
+ */
+static std::string im_concatenate_file(const IMbdd& bdd,
+				       std::string person,
+				       std::string activity){
+  std::string rep(bdd.getFolder() + "/" + person + "/" + activity);
+  DIR * repertoire = opendir(rep.c_str());
+  if (!repertoire){
+    std::cerr << "Impossible to open the feature points directory!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  
+  // Checking that the file concatenate.<activity>.fp exists
+  std::string name("concatenate." + activity + ".fp");
+  struct dirent * ent = readdir(repertoire);
+  while (ent && name.compare(ent->d_name) != 0)
+    ent = readdir(repertoire);
+  closedir(repertoire);
+  if(!ent){
+    std::cerr << "No file concatenate.<activity>.fp" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return rep + "/" + name;
+}
+
+/**
+ * \fn static KMdata* im_read_training_files(const IMbdd& bdd, const std::vector<std::string>& fpFiles, int nr_people, int* actIndex)
+ * \brief Imports the first maxPts descriptors of each file in the pool
+ * (see im_import_training_pool).
+ */
+static KMdata* im_read_training_files(const IMbdd& bdd,
+				      const std::vector<std::string>& fpFiles,
+				      int nr_people,
+				      int* actIndex){
   int dim = bdd.getDim();
   int maxPts = bdd.getMaxPts();
+  int nr_files = fpFiles.size();
+  
+  int fpReserved[nr_files]; // number of rows reserved for each file
+  int ttReserved = 0;
+  for(int f=0 ; f<nr_files ; f++){
+    fpReserved[f] = countSTIPs(fpFiles[f], maxPts);
+    ttReserved += fpReserved[f];
+  }
+  
+  // Importing the feature points
+  // Each file is imported right after the previous one: the rows reserved
+  // but not used by a file are reused by the next one.
+  KMdata* fpPool = new KMdata(dim,ttReserved);
+  int nPts = 0;
+  for(int f=0 ; f<nr_files ; f++){
+    if(f%nr_people == 0)
+      actIndex[f/nr_people] = nPts;
+    nPts += importSTIPs(fpFiles[f], dim, fpReserved[f], fpPool, nPts);
+  } // a person who does not participate in an activity adds nothing
+  actIndex[nr_files/nr_people] = nPts;
+  fpPool->setNPts(nPts);
+  return fpPool;
+}
+
+/**
+ * \fn static KMdata* im_sample_training_files(const IMbdd& bdd, const std::vector<std::string>& fpFiles, int nr_people, int* actIndex)
+ * \brief Puts a uniform sample of bdd.getReservoirSize() descriptors of
+ * each activity in the pool (see im_import_training_pool).
+ *
+ * All the descriptors of all the files are read, concurrently: the sample
+ * of each file (KMreservoir) is merged in the one of its activity as soon
+ * as the file is read, so at most one reservoir per thread and one per
+ * activity are in memory, whatever the size of the files.
+ */
+static KMdata* im_sample_training_files(const IMbdd& bdd,
+					const std::vector<std::string>& fpFiles,
+					int nr_people,
+					int* actIndex){
+  int dim = bdd.getDim();
+  int size = bdd.getReservoirSize();
+  int nr_files = fpFiles.size();
+  int nr_class = nr_files/nr_people;
+  
+  KMreservoir* reservoirs[nr_class];
+  for(int a=0 ; a<nr_class ; a++)
+    reservoirs[a] = new KMreservoir(dim, size);
+  int seed = (int) time(NULL);
+#pragma omp parallel for schedule(dynamic,1)
+  for(int f=0 ; f<nr_files ; f++){
+    kmIdum = -(seed + f);
+    KMreservoir fpReservoir(dim, size);
+    kmStreamSTIPs(fpFiles[f], dim, fpReservoir);
+#pragma omp critical(im_reservoirs)
+    reservoirs[f/nr_people]->add(fpReservoir);
+  }
+  
+  int nPts = 0;
+  for(int a=0 ; a<nr_class ; a++)
+    nPts += reservoirs[a]->getNPts();
+  KMdata* fpPool = new KMdata(dim, (nPts > 0) ? nPts : 1);
+  nPts = 0;
+  for(int a=0 ; a<nr_class ; a++){
+    actIndex[a] = nPts;
+    for(int i=0 ; i<reservoirs[a]->getNPts() ; i++){
+      for(int d=0 ; d<dim ; d++)
+	(*fpPool)[nPts][d] = reservoirs[a]->getPts()[i][d];
+      nPts++;
+    }
+    std::cout << reservoirs[a]->getNPts() << " descriptors sampled among "
+	      << reservoirs[a]->getNrDescriptors() << std::endl;
+    delete reservoirs[a];
+  }
+  actIndex[nr_class] = nPts;
+  fpPool->setNPts(nPts);
+  return fpPool;
+}
+
+/**
+ * \fn KMdata* im_import_training_pool(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, int* actIndex)
+ * \brief Imports the descriptors of the training people (the files
+ * concatenate.<activity>.fp) once in a single pool, activity after activity.
+ *
+ * Without reservoir, the first maxPts descriptors of each file are
+ * imported. With a reservoir (bdd.getReservoirSize() > 0) all the files are
+ * read and the pool holds a uniform sample of reservoirSize descriptors of
+ * each activity: the codebook is not biased towards the beginning of the
+ * files and the memory does not depend on their size.
+ *
+ * If the BDD uses a PCA, it is fitted on a sample of the pool and exported
+ * (so it is fitted on the same people as the codebook), and the returned
+ * pool is projected: its dimension is bdd.getCodebookDim().
+ *
+ * \param[in] bdd The BDD.
+ * \param[in] trainingPeople The people whose descriptors are imported.
+ * \param[out] actIndex An array of nr_activities+1 integers: the points of
+ * the activity a are the rows [actIndex[a], actIndex[a + 1]) of the pool.
+ * \return The pool (to be deleted by the caller).
+ */
+KMdata* im_import_training_pool(const IMbdd& bdd,
+				const std::vector<std::string>& trainingPeople,
+				int* actIndex){
+  std::string path2bdd(bdd.getFolder());
+  int dim = bdd.getDim();
   
   std::vector <std::string> activities = bdd.getActivities();
   int nr_class = activities.size();
-  
   int nr_people = trainingPeople.size();
   
-  // The total number of centers
-  int k = bdd.getK();
-  int subK = k/nr_class;
-  if(k%nr_class != 0){
-    std::cerr << "K is no divisible by the number of activities !!" << std::endl;
+  std::vector<std::string> fpFiles(nr_class*nr_people);
+  for(int a=0 ; a<nr_class ; a++)
+    for(int p=0 ; p<nr_people ; p++)
+      fpFiles[a*nr_people + p] = im_concatenate_file(bdd, trainingPeople[p], activities[a]);
+  
+  KMdata* fpPool;
+  if(bdd.getReservoirSize() > 0)
+    fpPool = im_sample_training_files(bdd, fpFiles, nr_people, actIndex);
+  else
+    fpPool = im_read_training_files(bdd, fpFiles, nr_people, actIndex);
+  
+  if(bdd.getPCADim() > 0){
+    int nPts = fpPool->getNPts();
+    int sampleSize = (nPts < KM_PCA_MAX_SAMPLE) ? nPts : KM_PCA_MAX_SAMPLE;
+    int* sampleIdx = new int[nPts];
+    kmIdum = - (int) time(NULL);
+    kmSampleIndices(nPts, sampleSize, sampleIdx);
+    KMdata sample(dim, sampleSize);
+    for(int i=0 ; i<sampleSize ; i++)
+      for(int d=0 ; d<dim ; d++)
+	sample[i][d] = (*fpPool)[sampleIdx[i]][d];
+    delete[] sampleIdx;
+    KMpca pca(sample, bdd.getPCADim());
+    pca.exportPCA(path2bdd + "/" + bdd.getPCAFile());
+    std::cout << "PCA: " << dim << " -> " << pca.getOutDim() << " dimensions ("
+	      << pca.getExplainedVariance()*100 << "% of the variance)" << std::endl;
+    
+    KMdata* projected = new KMdata(pca.getOutDim(), nPts);
+    pca.project(*fpPool, *projected);
+    delete fpPool;
+    fpPool = projected;
+  }
+  return fpPool;
+}
+
+/**
+ * \fn KMpca* im_load_pca(const IMbdd& bdd)
+ * \brief Loads the PCA of the BDD.
+ *
+ * \param[in] bdd The BDD.
+ * \return The PCA (to be deleted by the caller) or NULL if the BDD has none.
+ */
+KMpca* im_load_pca(const IMbdd& bdd){
+  if(bdd.getPCADim() <= 0)
+    return NULL;
+  std::string file(bdd.getFolder() + "/" + bdd.getPCAFile());
+  KMpca* pca = new KMpca(file);
+  if(pca->getInDim() != bdd.getDim() || pca->getOutDim() != bdd.getPCADim()){
+    std::cerr << "The PCA " << file << " does not match the BDD configuration!" << std::endl;
     exit(EXIT_FAILURE);
   }
-  double ***vDataPts = new double**[nr_class];
-  int nrFP[nr_class]; // number of feature points for each class
-  int currentActivity = 0;
-  // For each activity
-  for(std::vector<std::string>::iterator activity = activities.begin() ;
-      activity != activities.end() ;
-      ++activity){
-    nrFP[currentActivity] = 0;
-    
-    // We concatenate all the training people
-    int nrFPpP[nr_people]; // number of feature points per person
-    double*** activityDataPts = new double**[nr_people];
-    int currentPerson = 0;
-    for(std::vector<std::string>::const_iterator person = trainingPeople.begin() ;
-	person != trainingPeople.end() ;
-	++person){
-      nrFPpP[currentPerson] = 0;
-      std::string rep(path2bdd + "/" + *person + "/" + *activity);
-      DIR * repertoire = opendir(rep.c_str());
-      if (!repertoire){
-	std::cerr << "Impossible to open the feature points directory!" << std::endl;
-	exit(EXIT_FAILURE);
-      }
-      
-      // Checking that the file concatenate.<activity>.fp exists
-      struct dirent * ent = readdir(repertoire);
-      std::string file(ent->d_name);
-      while (ent && (file.compare("concatenate." + *activity + ".fp")) != 0){
-	ent = readdir(repertoire);
-	file = ent->d_name;
-      }
-      if(!ent){
-	std::cerr << "No file concatenate.<activity>.fp" << std::endl;
-	exit(EXIT_FAILURE);
-      }
-      
-      // Importing the feature points
-      std::string path2FP(rep + "/" + file);
-      KMdata kmData(dim,maxPts);
-      nrFPpP[currentPerson] = importSTIPs(path2FP, dim, maxPts, &kmData);
-      if(nrFPpP[currentPerson] != 0){
-	activityDataPts[currentPerson] = new double*[nrFPpP[currentPerson]];
-	for(int n = 0 ; n<nrFPpP[currentPerson] ; n++){
-	  activityDataPts[currentPerson][n] = new double [dim];
-	  for(int d = 0 ; d<dim ; d++)
-	    activityDataPts[currentPerson][n][d] = kmData[n][d];
-	}
-      } // else the current person does not participate in this activity
-      nrFP[currentActivity] += nrFPpP[currentPerson];
-      currentPerson++;
-    } // ++person
-    
-    // Saving people in vDataPts
-    vDataPts[currentActivity] = new double*[nrFP[currentActivity]];
-    int index=0;
+  return pca;
+}
+
+/**
+ * \fn void im_set_pca(std::string bddName, int pcaDim)
+ * \brief Enables (pcaDim > 0) or disables (pcaDim = 0) the PCA of the BDD.
+ * It is fitted during the next training (compute or test).
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] pcaDim The dimension of the projected descriptors.
+ */
+void im_set_pca(std::string bddName, int pcaDim){
+  std::string path2bdd("bdd/" + bddName);
+  IMbdd bdd(bddName,path2bdd);
+  bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+  if(pcaDim < 0 || pcaDim > bdd.getDim()){
+    std::cerr << "The PCA dimension must be in [0," << bdd.getDim() << "]!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if(pcaDim == bdd.getDim())
+    pcaDim = 0; // nothing to reduce
+  bdd.changePCASettings(pcaDim, (pcaDim > 0) ? "training.pca" : "");
+  bdd.write_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+}
+
+/**
+ * \fn void im_set_coreset(std::string bddName, int size)
+ * \brief Makes the specifical k-means run on a weighted coreset of size
+ * points per activity (size > 0) or on the imported descriptors (size = 0).
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] size The number of weighted points of each coreset.
+ */
+void im_set_coreset(std::string bddName, int size){
+  std::string path2bdd("bdd/" + bddName);
+  IMbdd bdd(bddName,path2bdd);
+  bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+  if(size < 0 || (size > 0 && size < KM_CORESET_MAX_SEEDS)){
+    std::cerr << "The coreset size must be 0 or at least " << KM_CORESET_MAX_SEEDS << "!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  bdd.changeCoresetSettings(size);
+  bdd.write_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+}
+
+/**
+ * \fn void im_set_reservoir(std::string bddName, int size)
+ * \brief Makes the k-means run on a uniform sample of size descriptors of
+ * each activity, drawn among all the descriptors (size > 0), or on the
+ * first maxPts descriptors of each file (size = 0).
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] size The number of descriptors sampled for each activity.
+ */
+void im_set_reservoir(std::string bddName, int size){
+  std::string path2bdd("bdd/" + bddName);
+  IMbdd bdd(bddName,path2bdd);
+  bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+  if(size < 0){
+    std::cerr << "The reservoir size must be positive!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  bdd.changeReservoirSettings(size);
+  bdd.write_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+}
+
+/**
+ * \fn void im_set_linear(std::string bddName, int order)
+ * \brief Makes the training produce linear models on the feature map of
+ * the given order of the kernel (order > 0), which predict much faster, or
+ * the kernel SVMs (order = 0).
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] order The order of the feature map.
+ */
+void im_set_linear(std::string bddName, int order){
+  std::string path2bdd("bdd/" + bddName);
+  IMbdd bdd(bddName,path2bdd);
+  bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+  if(order < 0){
+    std::cerr << "The order of the feature map must be positive!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  bdd.changeLinearSettings(order);
+  bdd.write_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+}
+
+/**
+ * \fn void im_set_approximation(std::string bddName, bool approximate)
+ * \brief Makes the training also export the CHIS and INTERS kernel models
+ * as linear models on their feature map, which the recognition then uses
+ * instead of the kernel models (faster, but approximate: the accuracy of
+ * both is displayed by the training), or not (the default).
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] approximate True to predict with the linear approximation.
+ */
+void im_set_approximation(std::string bddName, bool approximate){
+  std::string path2bdd("bdd/" + bddName);
+  IMbdd bdd(bddName,path2bdd);
+  bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+  bdd.changeApproxSettings(approximate);
+  bdd.write_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+}
+
+/**
+ * \fn void im_build_training_coresets(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, int nrSeeds, KMcoreset** coresets)
+ * \brief Summarizes all the descriptors of each activity (of the training
+ * people) in a coreset of bdd.getCoresetSize() weighted points.
+ *
+ * The files concatenate.<activity>.fp are streamed in one pass, each one in
+ * its own coreset and concurrently (see kmStreamSTIPs): none of them is
+ * truncated at maxPts. The coresets of the people are then merged for each
+ * activity.
+ *
+ * \param[in] bdd The BDD.
+ * \param[in] trainingPeople The training people.
+ * \param[in] nrSeeds The number of seeds of the reductions (see KMcoreset).
+ * \param[out] coresets The nr_activities finished coresets (of dimension
+ * bdd.getDim(), to be deleted by the caller).
+ */
+void im_build_training_coresets(const IMbdd& bdd,
+				const std::vector<std::string>& trainingPeople,
+				int nrSeeds,
+				KMcoreset** coresets){
+  int dim = bdd.getDim();
+  int size = bdd.getCoresetSize();
+  std::vector <std::string> activities = bdd.getActivities();
+  int nr_class = activities.size();
+  int nr_people = trainingPeople.size();
+
+  int nr_files = nr_class*nr_people;
+  std::vector<std::string> fpFiles(nr_files);
+  for(int a=0 ; a<nr_class ; a++)
+    for(int p=0 ; p<nr_people ; p++)
+      fpFiles[a*nr_people + p] = im_concatenate_file(bdd, trainingPeople[p], activities[a]);
+
+  // One coreset per file
+  KMcoreset* fpCoresets[nr_files];
+  int seed = (int) time(NULL);
+#pragma omp parallel for schedule(dynamic,1)
+  for(int f=0 ; f<nr_files ; f++){
+    kmIdum = -(seed + f);
+    fpCoresets[f] = new KMcoreset(dim, size, nrSeeds);
+    kmStreamSTIPs(fpFiles[f], dim, *fpCoresets[f]);
+    fpCoresets[f]->finish();
+  }
+
+  // Merging the coresets of the people for each activity
+#pragma omp parallel for schedule(dynamic,1)
+  for(int a=0 ; a<nr_class ; a++){
+    kmIdum = -(seed + nr_files + a);
+    coresets[a] = new KMcoreset(dim, size, nrSeeds);
     for(int p=0 ; p<nr_people ; p++){
-      for(int fp=0 ; fp<nrFPpP[p] ; fp++){
-	vDataPts[currentActivity][index] = new double[dim];
-	for(int d=0 ; d<dim ; d++){
-	  vDataPts[currentActivity][index][d] = activityDataPts[p][fp][d];
-	}
-	index++;
+      coresets[a]->add(*fpCoresets[a*nr_people + p]);
+      delete fpCoresets[a*nr_people + p];
+    }
+    coresets[a]->finish();
+  }
+  for(int a=0 ; a<nr_class ; a++)
+    std::cout << activities[a] << ": " << coresets[a]->getNrDescriptors()
+	      << " descriptors summarized in " << coresets[a]->getNPts()
+	      << " weighted points" << std::endl;
+}
+
+/**
+ * \fn static void im_project_coresets(const IMbdd& bdd, KMcoreset** coresets, int nr_class, KMdata** projected)
+ * \brief Fits the PCA of the BDD on the union of the weighted coresets of
+ * the activities, exports it, and projects each coreset.
+ *
+ * \param[out] projected The nr_class projected points (to be deleted).
+ */
+static void im_project_coresets(const IMbdd& bdd, KMcoreset** coresets, int nr_class,
+				KMdata** projected){
+  int dim = bdd.getDim();
+  int nPts = 0;
+  for(int a=0 ; a<nr_class ; a++)
+    nPts += coresets[a]->getNPts();
+  KMdata all(dim, nPts);
+  double* weights = new double[nPts];
+  int n = 0;
+  for(int a=0 ; a<nr_class ; a++){
+    for(int i=0 ; i<coresets[a]->getNPts() ; i++){
+      for(int d=0 ; d<dim ; d++)
+	all[n][d] = coresets[a]->getPts()[i][d];
+      weights[n] = coresets[a]->getWeights()[i];
+      n++;
+    }
+  }
+  KMpca pca(all, bdd.getPCADim(), weights);
+  delete[] weights;
+  pca.exportPCA(bdd.getFolder() + "/" + bdd.getPCAFile());
+  std::cout << "PCA: " << dim << " -> " << pca.getOutDim() << " dimensions ("
+	    << pca.getExplainedVariance()*100 << "% of the variance)" << std::endl;
+  for(int a=0 ; a<nr_class ; a++){
+    int nA = coresets[a]->getNPts();
+    projected[a] = new KMdata(pca.getOutDim(), (nA > 0) ? nA : 1);
+    pca.project(coresets[a]->getPts(), *projected[a]);
+  }
+}
+
+/**
+ * \fn static KMpointArray im_load_descriptor_centers(const IMbdd& bdd)
+ * \brief Loads the centers of the specifical codebook in the space of the
+ * descriptors (they are back-projected if the BDD uses a PCA).
+ *
+ * \return The k centers of dimension bdd.getDim() (kmDeallocPts).
+ */
+static KMpointArray im_load_descriptor_centers(const IMbdd& bdd){
+  KMquantizer codebook(bdd.getFolder() + "/" + bdd.getKMeansFile(),
+		       bdd.getCodebookDim(), bdd.getK());
+  KMpca* pca = im_load_pca(bdd);
+  KMpointArray ctrs = kmAllocPts(bdd.getK(), bdd.getDim());
+  for(int c=0 ; c<bdd.getK() ; c++){
+    if(pca)
+      pca->backProject(codebook.getCenter(c), ctrs[c]);
+    else
+      for(int d=0 ; d<bdd.getDim() ; d++)
+	ctrs[c][d] = codebook.getCenter(c)[d];
+  }
+  delete pca;
+  return ctrs;
+}
+
+/**
+ * \fn static KMdata* im_activity_points(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, int subK, KMdata** actPts, double** actWeights)
+ * \brief Gives the points clustered for each activity: its rows of the
+ * pool, or its weighted coreset if the BDD uses coresets. If the BDD uses a
+ * PCA, it is fitted (and exported) and the points are projected.
+ *
+ * \param[in] bdd The BDD.
+ * \param[in] trainingPeople The training people.
+ * \param[in] subK The number of centers of each activity.
+ * \param[out] actPts The points of each activity (to be deleted).
+ * \param[out] actWeights Their weights (NULL for the pool, to be deleted[]).
+ * \return The pool the points are views of (NULL with coresets), to be
+ * deleted after them.
+ */
+static KMdata* im_activity_points(const IMbdd& bdd,
+				  const std::vector<std::string>& trainingPeople,
+				  int subK,
+				  KMdata** actPts,
+				  double** actWeights){
+  int nr_class = bdd.getActivities().size();
+  if(bdd.getCoresetSize() > 0){
+    // Each activity is summarized in a weighted coreset, clustered with
+    // the weighted Lloyd's algorithm
+    int nrSeeds = (subK < KM_CORESET_MAX_SEEDS) ? subK : KM_CORESET_MAX_SEEDS;
+    KMcoreset* coresets[nr_class];
+    im_build_training_coresets(bdd, trainingPeople, nrSeeds, coresets);
+    if(bdd.getPCADim() > 0)
+      im_project_coresets(bdd, coresets, nr_class, actPts);
+    for(int a=0 ; a<nr_class ; a++){
+      int n = coresets[a]->getNPts();
+      if(bdd.getPCADim() <= 0){
+	actPts[a] = new KMdata(bdd.getDim(), (n > 0) ? n : 1);
+	actPts[a]->setNPts(n);
+	for(int i=0 ; i<n ; i++)
+	  for(int d=0 ; d<bdd.getDim() ; d++)
+	    (*actPts[a])[i][d] = coresets[a]->getPts()[i][d];
       }
-    } // index must be equal to nrFP[currentActivity] - 1
-    
-    // Deleting activityDataPts
-    for(int p=0 ; p<nr_people ; p++){
-      for(int fp=0 ; fp < nrFPpP[p] ; fp++)
-	delete[] activityDataPts[p][fp];
-      delete[] activityDataPts[p];
+      actWeights[a] = new double[(n > 0) ? n : 1];
+      for(int i=0 ; i<n ; i++)
+	actWeights[a][i] = coresets[a]->getWeights()[i];
+      delete coresets[a];
     }
-    delete[] activityDataPts;
-    currentActivity++;
-  } // ++activity
+    return NULL;
+  }
   
-  // Total number of feature points
-  int ttFP = 0;
+  // The descriptors are stored once in a single pool
+  int actIndex[nr_class + 1];
+  KMdata* fpPool = im_import_training_pool(bdd, trainingPeople, actIndex);
   for(int a=0 ; a<nr_class ; a++){
-    ttFP += nrFP[a];
+    actPts[a] = new KMdata(*fpPool, actIndex[a], actIndex[a+1] - actIndex[a]);
+    actWeights[a] = NULL;
   }
+  return fpPool;
+}
+
+/**
+ * \fn static void im_init_centers(const IMbdd& bdd, const KMpointArray initCtrs, KMpointArray ctrs)
+ * \brief Projects initial centers given in the space of the descriptors
+ * with the PCA just fitted for the training people (if any).
+ *
+ * \param[out] ctrs The k centers of dimension bdd.getCodebookDim().
+ */
+static void im_init_centers(const IMbdd& bdd, const KMpointArray initCtrs,
+			    KMpointArray ctrs){
+  KMpca* pca = im_load_pca(bdd);
+  for(int c=0 ; c<bdd.getK() ; c++){
+    if(pca)
+      pca->project(initCtrs[c], ctrs[c]);
+    else
+      for(int d=0 ; d<bdd.getDim() ; d++)
+	ctrs[c][d] = initCtrs[c][d];
+  }
+  delete pca;
+}
+
+/**
+ * \fn int im_create_specifics_training_means(IMbdd bdd, const std::vector<std::string>& trainingPeople, const KMpointArray initCtrs)
+ * \brief Creates the specifical codebook: subK = k/nr_activities centers
+ * for each activity, computed on the descriptors of the activity (on its
+ * coreset if the BDD uses coresets).
+ *
+ * \param[in] bdd The BDD.
+ * \param[in] trainingPeople The training people.
+ * \param[in] initCtrs If not NULL, the k centers (in the space of the
+ * descriptors, see im_load_descriptor_centers) of a previous codebook:
+ * they are only refined by IM_WARM_STAGES Lloyd's stages instead of
+ * running the whole k-means.
+ * \return The number of centers.
+ */
+int im_create_specifics_training_means(IMbdd bdd,
+				       const std::vector<std::string>& trainingPeople,
+				       //std::vector <std::string> rejects
+				       const KMpointArray initCtrs){
+  int dim = bdd.getCodebookDim();
   
-  // Memory allocation of the centers
-  double** vCtrs = new double*[k];
-  for(int i=0 ; i<k ; i++){
-    vCtrs[i] = new double[dim];
+  std::vector <std::string> activities = bdd.getActivities();
+  int nr_class = activities.size();
+  
+  // The total number of centers
+  int k = bdd.getK();
+  int subK = k/nr_class;
+  if(k%nr_class != 0){
+    std::cerr << "K is no divisible by the number of activities !!" << std::endl;
+    exit(EXIT_FAILURE);
   }
+  // Memory allocation of the centers
+  KMpointArray vCtrs = kmAllocPts(k, dim);
+  int ic = 3; // the iteration coefficient (Ivan's algorithm)
+  int seed = (int) time(NULL);
+  
+  KMdata* actPts[nr_class];
+  double* actWeights[nr_class];
+  KMdata* fpPool = im_activity_points(bdd, trainingPeople, subK, actPts, actWeights);
+  if(initCtrs)
+    im_init_centers(bdd, initCtrs, vCtrs);
   
   // Doing the KMeans algorithm for each activities
-  int ic = 3; // the iteration coefficient (Ivan's algorithm)
-  int currCenter = 0;
+  // The activities are independent: they are clustered concurrently and
+  // each one writes its subK centers at its own place in vCtrs, so that
+  // the codebook stays in the activity order.
+#pragma omp parallel for schedule(dynamic,1)
   for(int i=0 ; i<nr_class ; i++){
-    KMdata kmData(dim,nrFP[i]);
-    for(int n=0 ; n<nrFP[i]; n++)
-      for(int d=0 ; d<dim ; d++)
-	kmData[n][d] = vDataPts[i][n][d];
-    kmData.setNPts(nrFP[i]);
-    kmData.buildKcTree();
-    KMfilterCenters kmCtrs(subK,kmData);
-    kmIvanAlgorithm(ic, dim, kmData, subK, kmCtrs);
-    for(int n=0 ; n<subK ; n++){
-      for(int d=0 ; d<dim ; d++){
-	vCtrs[currCenter][d] = kmCtrs[n][d];
-      }
-      currCenter++;
+    kmIdum = -(seed + i); // the generator of this thread, seeded for this activity
+    KMcenters kmCtrs(subK,*actPts[i]);
+    if(initCtrs){
+      for(int n=0 ; n<subK ; n++)
+	for(int d=0 ; d<dim ; d++)
+	  kmCtrs[n][d] = vCtrs[i*subK + n][d];
+      for(int stage=0 ; stage<IM_WARM_STAGES ; stage++)
+	kmLloydStage(*actPts[i], kmCtrs, actWeights[i]);
     }
-  }
-  
-  std::cout << "Concatenate KMdata" << std::endl;
-  // Concatenate all the KMdata
-  /* In reality it is not necessary
-     but the objectif KMfilterCenters must be initialized with
-     the KMdata */
-  KMdata dataPts(dim,ttFP);
-  int nPts = 0;
-  for (int i=0 ; i<nr_class ; i++){
-    for(int n=0 ; n<nrFP[i]; n++){
+    else if(actWeights[i])
+      kmWeightedAlgorithm(ic, *actPts[i], actWeights[i], subK, kmCtrs);
+    else
+      kmIvanAlgorithm(ic, dim, *actPts[i], subK, kmCtrs);
+    for(int n=0 ; n<subK ; n++){
       for(int d=0 ; d<dim ; d++){
-	dataPts[nPts][d] = vDataPts[i][n][d];
+	vCtrs[i*subK + n][d] = kmCtrs[n][d];
       }
-      nPts++;
     }
   }
-  // Releasing vDataPts
   for(int i=0 ; i<nr_class ; i++){
-    for(int n=0 ; n<nrFP[i] ; n++)
-      delete [] vDataPts[i][n];
-    delete [] vDataPts[i];
-  }
-  delete[] vDataPts;
-  
-  dataPts.buildKcTree();
-  // Returning the true centers
-  KMfilterCenters ctrs(k,dataPts);
-  for(int n=0 ; n<k ; n++){
-    for(int d=0 ; d<dim ; d++){
-      ctrs[n][d] = vCtrs[n][d];
-    }
+    delete actPts[i];
+    delete[] actWeights[i];
   }
-  
-  // Releasing vCtrs
-  for(int i=0 ; i<k ; i++)
-    delete [] vCtrs[i];
-  delete[]vCtrs;
+  delete fpPool;
   
   exportCenters(bdd.getFolder() + "/" + bdd.getKMeansFile(),
-		dim, k, ctrs);
+		dim, k, vCtrs);
+  
+  // Releasing vCtrs
+  kmDeallocPts(vCtrs);
   
   return k;
 }
 
 /**
- * \fn void trainBdd(std::string bddName, int dim, int maxPts, int k)
+ * \fn int im_create_vocabulary_tree(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, int b, int L)
+ * \brief Builds a vocabulary tree (see KMvocabularyTree) over the
+ * descriptors of all the training people and all the activities, and
+ * exports it in the k-means file of the BDD.
+ *
+ * \param[in] bdd The BDD.
+ * \param[in] trainingPeople The training people.
+ * \param[in] b The branching factor.
+ * \param[in] L The depth.
+ * \return The number of words (b^L).
+ */
+int im_create_vocabulary_tree(const IMbdd& bdd,
+			      const std::vector<std::string>& trainingPeople,
+			      int b, int L){
+  int actIndex[bdd.getActivities().size() + 1];
+  KMdata* fpPool = im_import_training_pool(bdd, trainingPeople, actIndex);
+  
+  KMvocabularyTree tree(bdd.getCodebookDim(), b, L);
+  int ic = 3; // the iteration coefficient
+  kmIdum = - (int) time(NULL);
+  kmVocabularyTree(ic, *fpPool, tree);
+  tree.exportTree(bdd.getFolder() + "/" + bdd.getKMeansFile());
+  delete fpPool;
+  
+  return tree.getK();
+}
+
+/**
+ * \fn KMcodebook* im_load_codebook(const IMbdd& bdd)
+ * \brief Loads the codebook of the BDD: the vocabulary tree if the k-means
+ * algorithm is "tree", the flat centers otherwise.
+ *
+ * \param[in] bdd The BDD.
+ * \return The codebook (to be deleted by the caller).
+ */
+KMcodebook* im_load_codebook(const IMbdd& bdd){
+  std::string file(bdd.getFolder() + "/" + bdd.getKMeansFile());
+  if(bdd.getKMAlgorithm().compare("tree") == 0){
+    KMvocabularyTree* tree = new KMvocabularyTree(file);
+    if(tree->getK() != bdd.getK() || tree->getDim() != bdd.getCodebookDim()){
+      std::cerr << "The vocabulary tree " << file
+		<< " does not match the BDD configuration!" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    return tree;
+  }
+  return new KMquantizer(file, bdd.getCodebookDim(), bdd.getK());
+}
+
+/**
+ * \fn static std::string im_artifact_prefix(const IMbdd& bdd)
+ * \brief Gives the folder of the codebook of the BDD, relative to the BDD
+ * folder ("" or ending with '/'): the files trained with the codebook
+ * (normalization, SVM models) are saved there too.
+ */
+static std::string im_artifact_prefix(const IMbdd& bdd){
+  std::string file(bdd.getKMeansFile());
+  size_t slash = file.find_last_of('/');
+  return (slash == std::string::npos) ? "" : file.substr(0, slash + 1);
+}
+
+/**
+ * \fn void im_change_codebook_settings(IMbdd& bdd, int k, int treeDepth)
+ * \brief Saves the k-means settings of the BDD: specific training means
+ * (k centers, k/nrActivities per activity) or a vocabulary tree of
+ * branching factor k and depth treeDepth (k^treeDepth words).
+ */
+static void im_change_codebook_settings(IMbdd& bdd, int k, int treeDepth){
+  if(treeDepth > 0){
+    int words = 1;
+    for(int l=0 ; l<treeDepth ; l++)
+      words *= k;
+    bdd.changeKMSettings("tree", words, "training.voctree");
+  }
+  else{
+    if(k%(int)bdd.getActivities().size() != 0){
+      std::cerr << "k is not divisible by nrActivities !" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    bdd.changeKMSettings("specifical", k, "training.means");
+  }
+}
+
+/**
+ * \fn void im_create_codebook(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, int k, int treeDepth)
+ * \brief Creates the codebook set by im_change_codebook_settings.
+ */
+static void im_create_codebook(const IMbdd& bdd,
+			       const std::vector<std::string>& trainingPeople,
+			       int k, int treeDepth){
+  if(treeDepth > 0)
+    im_create_vocabulary_tree(bdd, trainingPeople, k, treeDepth);
+  else
+    im_create_specifics_training_means(bdd, trainingPeople);
+}
+
+/**
+ * \fn void im_train_bdd(std::string bddName, int k, int treeDepth)
  * \brief Trains the specified BDD.
  *
  * \param[in] bddName The name of the BDD.
- * \param[in] dim The dimension of the STIPs.
- * \param[in] maxPts The maximum number of points we want to compute.
- * \param[in] k The number of cluster (means).
+ * \param[in] k The number of cluster (means), or the branching factor
+ * of the vocabulary tree.
+ * \param[in] treeDepth The depth of the vocabulary tree (0: no tree).
  */
-void im_train_bdd(std::string bddName, int k){
+void im_train_bdd(std::string bddName, int k, int treeDepth){
   std::string path2bdd("bdd/" + bddName);
   std::string KMeansFile(path2bdd + "/" + "training.means");
   
@@ -870,16 +1416,10 @@ void im_train_bdd(std::string bddName, int k){
     labels[index] = index + 1;
     index++;
   }
-  if(k%nrActivities != 0){
-    std::cerr << "k is not divisible by nrActivities !" << std::endl;
-    exit(EXIT_FAILURE);
-  }
   
   // Saving KMeans settings
-  bdd.changeKMSettings("specifical",
-		       k,
-		       "training.means");
-  im_create_specifics_training_means(bdd, trainingPeople);
+  im_change_codebook_settings(bdd, k, treeDepth);
+  im_create_codebook(bdd, trainingPeople, k, treeDepth);
   
   // SVM train
   MatrixC trainMC = MatrixC(nrActivities,labels);
@@ -900,8 +1440,61 @@ void im_train_bdd(std::string bddName, int k){
   std::cout << "\t total number of train BOWs=" << trainMC.nrTest << std::endl;
 }
 
-void im_leave_one_out(std::string bddName,
-		      int k){
+/**
+ * \fn static void im_set_fold_folder(IMbdd& bdd, std::string person)
+ * \brief Makes the files trained without a person (codebook, PCA,
+ * normalization and SVM models, see im_artifact_prefix) be saved in the
+ * folder fold_<person> of the BDD, so that the folds of the
+ * leave-one-person-out can run concurrently.
+ */
+static void im_set_fold_folder(IMbdd& bdd, std::string person){
+  std::string fold("fold_" + person);
+  mkdir((bdd.getFolder() + "/" + fold).c_str(),S_IRWXU|S_IRGRP|S_IXGRP); // rwx pour user
+  bdd.changeKMSettings(bdd.getKMAlgorithm(), bdd.getK(),
+		       fold + "/" + bdd.getKMeansFile());
+  if(bdd.getPCADim() > 0)
+    bdd.changePCASettings(bdd.getPCADim(), fold + "/" + bdd.getPCAFile());
+}
+
+/**
+ * \fn static void im_remove_fold_folder(const IMbdd& bdd, std::string person)
+ * \brief Deletes the folder fold_<person> of the BDD (see
+ * im_set_fold_folder) and the files trained without the person.
+ */
+static void im_remove_fold_folder(const IMbdd& bdd, std::string person){
+  std::string fold(bdd.getFolder() + "/fold_" + person);
+  emptyFolder(fold);
+  rmdir(fold.c_str());
+}
+
+/**
+ * \fn static void im_create_fold_codebook(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, int k, int treeDepth, const KMpointArray warmCtrs)
+ * \brief Creates the codebook of a fold: refined from warmCtrs if it is
+ * not NULL, trained from scratch otherwise.
+ */
+static void im_create_fold_codebook(const IMbdd& bdd,
+				    const std::vector<std::string>& trainingPeople,
+				    int k, int treeDepth,
+				    const KMpointArray warmCtrs){
+  if(warmCtrs)
+    im_create_specifics_training_means(bdd, trainingPeople, warmCtrs);
+  else
+    im_create_codebook(bdd, trainingPeople, k, treeDepth);
+}
+
+/**
+ * \fn void im_leave_one_out(std::string bddName, int k, const IMleaveOneOutOptions& options)
+ * \brief Evaluates the BDD by leave-one-person-out: for each person, the
+ * codebook and the SVMs are trained on the other people and tested on him.
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] k The number of means, or the branching factor of the
+ * vocabulary tree.
+ * \param[in] options The codebook and the way the folds run (see
+ * IMleaveOneOutOptions).
+ */
+void im_leave_one_out(std::string bddName, int k,
+		      const IMleaveOneOutOptions& options){
   std::string path2bdd("bdd/" + bddName);
   std::string KMeansFile(path2bdd + "/" + "training.means");
   
@@ -911,7 +1504,8 @@ void im_leave_one_out(std::string bddName,
   bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
   
   // Saving KMeans settings
-  bdd.changeKMSettings("specifical", k, "training.means");
+  im_change_codebook_settings(bdd, k, options.treeDepth);
+  time_t start = time(NULL);
   
   // Loading feature points settings
   std::string descriptor = bdd.getDescriptor();
@@ -927,37 +1521,91 @@ void im_leave_one_out(std::string bddName,
     labels[index] = index + 1;
     index++;
   }
-  if(k%nrActivities != 0){
-    std::cerr << "k is not divisible by nrActivities !" << std::endl;
-    exit(EXIT_FAILURE);
-  }
   
   MatrixC trainMC = MatrixC(nrActivities,labels);
   MatrixC testMC = MatrixC(nrActivities,labels);
   double crossValidationAccuracy = 0;
   std::vector<std::string> people = bdd.getPeople();
+  
+  // The codebook of all the people, from which the folds' ones start
+  KMpointArray warmCtrs = NULL;
+  if(options.warmStart && options.treeDepth > 0)
+    std::cerr << "The warm start is only done for the specifical codebook!" << std::endl;
+  else if(options.warmStart){
+    std::cout << "Training the codebook of all the people..." << std::endl;
+    im_create_specifics_training_means(bdd, people);
+    warmCtrs = im_load_descriptor_centers(bdd);
+  }
   // Leave One Person Out 
-  for(std::vector<std::string>::iterator person = people.begin() ;
-      person != people.end();
-      ++person){
-    std::vector<std::string> testingPeople;
-    std::vector<std::string> trainingPeople;
-    testingPeople.push_back(*person);
+  int nrFolds = people.size();
+  std::vector<std::vector<std::string> > foldTraining(nrFolds), foldTesting(nrFolds);
+  std::vector<IMbdd> foldBdd(nrFolds, bdd);
+  std::vector<MatrixC*> foldTrainMC(nrFolds), foldTestMC(nrFolds);
+  std::vector<double> foldAccuracy(nrFolds, 0);
+  for(int f=0 ; f<nrFolds ; f++){
+    foldTesting[f].push_back(people[f]);
     // Filling trainingPeople
-    for(std::vector<std::string>::iterator trainingPerson = people.begin() ;
-	trainingPerson != people.end();
-	++trainingPerson){
-      if((*trainingPerson).compare(*person) != 0)
-	trainingPeople.push_back(*trainingPerson);
+    for(int p=0 ; p<nrFolds ; p++){
+      if(p != f)
+	foldTraining[f].push_back(people[p]);
     }
-    std::cout << "Testing" << *person << std::endl;
-    im_create_specifics_training_means(bdd, trainingPeople);
-    crossValidationAccuracy += im_svm_train(bdd,
-					    trainingPeople, trainMC,
-					    testingPeople, testMC);
-    std::cout << "Test " << *person << " ok!" << std::endl;
+    if(options.parallel)
+      im_set_fold_folder(foldBdd[f], people[f]);
+    foldTrainMC[f] = new MatrixC(nrActivities,labels);
+    foldTestMC[f] = new MatrixC(nrActivities,labels);
+  }
+  
+  if(options.singlePass){
+    // All the codebooks first, then the BOWs of all the folds together
+    std::vector<KMcodebook*> codebooks(nrFolds);
+    std::vector<KMpca*> pcas(nrFolds);
+#pragma omp parallel for schedule(dynamic,1) if(options.parallel)
+    for(int f=0 ; f<nrFolds ; f++){
+      std::cout << "Codebook without " << people[f] << std::endl;
+      im_create_fold_codebook(foldBdd[f], foldTraining[f], k, options.treeDepth, warmCtrs);
+      codebooks[f] = im_load_codebook(foldBdd[f]);
+      pcas[f] = im_load_pca(foldBdd[f]);
+    }
+    std::cout << "Computing the BOWs of all the folds..." << std::endl;
+    std::vector<std::map<std::string, struct svm_problem> > foldBOW;
+    im_compute_bdd_bows(bdd, codebooks, pcas, foldBOW);
+    for(int f=0 ; f<nrFolds ; f++){
+      delete codebooks[f];
+      delete pcas[f];
+    }
+#pragma omp parallel for schedule(dynamic,1) if(options.parallel)
+    for(int f=0 ; f<nrFolds ; f++){
+      std::cout << "Testing" << people[f] << std::endl;
+      foldAccuracy[f] = im_svm_train(foldBdd[f],
+				     foldTraining[f], *foldTrainMC[f],
+				     foldTesting[f], *foldTestMC[f],
+				     foldBOW[f]);
+      std::cout << "Test " << people[f] << " ok!" << std::endl;
+    }
+  }
+  else{
+#pragma omp parallel for schedule(dynamic,1) if(options.parallel)
+    for(int f=0 ; f<nrFolds ; f++){
+      std::cout << "Testing" << people[f] << std::endl;
+      im_create_fold_codebook(foldBdd[f], foldTraining[f], k, options.treeDepth, warmCtrs);
+      foldAccuracy[f] = im_svm_train(foldBdd[f],
+				     foldTraining[f], *foldTrainMC[f],
+				     foldTesting[f], *foldTestMC[f]);
+      std::cout << "Test " << people[f] << " ok!" << std::endl;
+    }
+  }
+  for(int f=0 ; f<nrFolds ; f++){
+    crossValidationAccuracy += foldAccuracy[f];
+    trainMC.addMatrix(*foldTrainMC[f]);
+    testMC.addMatrix(*foldTestMC[f]);
+    delete foldTrainMC[f];
+    delete foldTestMC[f];
+    if(options.parallel)
+      im_remove_fold_folder(bdd, people[f]);
   }
   crossValidationAccuracy /= people.size();
+  if(warmCtrs)
+    kmDeallocPts(warmCtrs);
   
   trainMC.calculFrequence();
   trainMC.exportMC(path2bdd,"training_confusion_matrix.txt");
@@ -971,7 +1619,12 @@ void im_leave_one_out(std::string bddName,
   std::cout << "#######################################" << std::endl;
   std::cout << "Number of people: " << people.size() << std::endl;
   std::cout << "Descriptor ID: " << descriptor << std::endl;
-  std::cout << "Number of means: " << k << std::endl;
+  std::cout << "Number of means: " << bdd.getK() << std::endl;
+  std::cout << "PCA dimension: " << bdd.getCodebookDim() << "/" << bdd.getDim() << std::endl;
+  std::cout << "Codebooks of the folds: " << (warmCtrs ? "warm-started" : "trained from scratch")
+	    << (options.singlePass ? ", quantized in a single pass" : "")
+	    << (options.parallel ? ", folds run concurrently" : "") << std::endl;
+  std::cout << "Duration of the test: " << difftime(time(NULL),start) << "s" << std::endl;
   std::cout << "Train recognition rate:" << std::endl;
   std::cout << "\t cross validation accuracy=" << crossValidationAccuracy << std::endl;
   std::cout << "\t tau_train=" << trainMC.recognitionRate*100 << "%" << std::endl;
@@ -980,6 +1633,328 @@ void im_leave_one_out(std::string bddName,
   std::cout << "\t tau_test=" << testMC.recognitionRate*100 << "%" << std::endl;
   std::cout << "\t total number of test BOWs=" << testMC.nrTest << std::endl;
 }
+/**
+ * \fn static void im_create_sweep_codebooks(IMbdd& bdd, const std::vector<std::string>& trainingPeople, const std::vector<int>& ks, std::vector<KMcodebook*>& codebooks)
+ * \brief Creates the specifical codebooks of several sizes on the same
+ * training people: the descriptors are imported (or summarized) once, the
+ * codebook of the smallest k is computed by the k-means, and each next one
+ * is grown from the previous one by splitting its clusters (see
+ * kmSplitCenters), for each activity.
+ *
+ * \param[in] bdd The BDD (its PCA is fitted and exported).
+ * \param[in] trainingPeople The training people.
+ * \param[in] ks The numbers of centers (increasing, divisible by the
+ * number of activities).
+ * \param[out] codebooks The codebooks, in the order of ks, are appended
+ * (to be deleted by the caller).
+ */
+static void im_create_sweep_codebooks(IMbdd& bdd,
+				      const std::vector<std::string>& trainingPeople,
+				      const std::vector<int>& ks,
+				      std::vector<KMcodebook*>& codebooks){
+  int nr_class = bdd.getActivities().size();
+  int nrK = ks.size();
+  int ic = 3; // the iteration coefficient (Ivan's algorithm)
+  int seed = (int) time(NULL);
+  
+  KMdata* actPts[nr_class];
+  double* actWeights[nr_class];
+  KMdata* fpPool = im_activity_points(bdd, trainingPeople, ks[nrK-1]/nr_class,
+				      actPts, actWeights);
+  int dim = bdd.getCodebookDim();
+  std::vector<KMpointArray> vCtrs(nrK);
+  for(int j=0 ; j<nrK ; j++)
+    vCtrs[j] = kmAllocPts(ks[j], dim);
+  
+#pragma omp parallel for schedule(dynamic,1)
+  for(int i=0 ; i<nr_class ; i++){
+    kmIdum = -(seed + i);
+    KMcenters* previous = NULL;
+    for(int j=0 ; j<nrK ; j++){
+      int subK = ks[j]/nr_class;
+      KMcenters* kmCtrs = new KMcenters(subK, *actPts[i]);
+      if(previous)
+	kmSplitCenters(ic, *actPts[i], actWeights[i], *previous, *kmCtrs);
+      else if(actWeights[i])
+	kmWeightedAlgorithm(ic, *actPts[i], actWeights[i], subK, *kmCtrs);
+      else
+	kmIvanAlgorithm(ic, dim, *actPts[i], subK, *kmCtrs);
+      for(int n=0 ; n<subK ; n++)
+	for(int d=0 ; d<dim ; d++)
+	  vCtrs[j][i*subK + n][d] = (*kmCtrs)[n][d];
+      delete previous;
+      previous = kmCtrs;
+    }
+    delete previous;
+  }
+  for(int i=0 ; i<nr_class ; i++){
+    delete actPts[i];
+    delete[] actWeights[i];
+  }
+  delete fpPool;
+  
+  for(int j=0 ; j<nrK ; j++){
+    codebooks.push_back(new KMquantizer(dim, ks[j], vCtrs[j]));
+    kmDeallocPts(vCtrs[j]);
+  }
+}
+
+/**
+ * \fn void im_k_sweep(std::string bddName, std::vector<int> ks)
+ * \brief Compares the specifical codebooks of several sizes by
+ * leave-one-person-out in one run. For each fold, the codebooks of all
+ * the k are grown from each other (see im_create_sweep_codebooks), then the
+ * descriptors are read once and quantized with the codebooks of all the
+ * folds and all the k (see im_compute_bdd_bows). The SVMs are trained for
+ * each k and fold on these BOWs.
+ *
+ * The table of the accuracies against k and the cost of the prediction of
+ * a video (the quantization: k.dim multiply-adds per descriptor and its
+ * time, measured with each codebook alone, and the size of the OVR models:
+ * their number of support vectors or the dimension of the feature map of
+ * the linear models) is displayed and exported in k_sweep.txt. The models
+ * of each fold are saved in its folder fold_<person>, not in the ones of
+ * the BDD, and the folders are deleted at the end.
+ *
+ * \param[in] bddName The name of the BDD.
+ * \param[in] ks The numbers of means.
+ */
+void im_k_sweep(std::string bddName, std::vector<int> ks){
+  std::string path2bdd("bdd/" + bddName);
+  IMbdd bdd(bddName,path2bdd);
+  bdd.load_bdd_configuration(path2bdd.c_str(),"imconfig.xml");
+  time_t start = time(NULL);
+  
+  std::vector<std::string> activities = bdd.getActivities();
+  int nrActivities = activities.size();
+  std::sort(ks.begin(), ks.end());
+  ks.erase(std::unique(ks.begin(), ks.end()), ks.end());
+  if(ks.size() == 0 || ks[0] < nrActivities){
+    std::cerr << "The sweep needs at least nrActivities means!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  for(unsigned int j=0 ; j<ks.size() ; j++){
+    if(ks[j]%nrActivities != 0){
+      std::cerr << "k=" << ks[j] << " is not divisible by nrActivities !" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  int nrK = ks.size();
+  int labels[nrActivities];
+  for(int i=0 ; i<nrActivities ; i++)
+    labels[i] = i + 1;
+  
+  // Leave One Person Out
+  std::vector<std::string> people = bdd.getPeople();
+  int nrFolds = people.size();
+  std::vector<std::vector<std::string> > foldTraining(nrFolds), foldTesting(nrFolds);
+  for(int f=0 ; f<nrFolds ; f++){
+    foldTesting[f].push_back(people[f]);
+    for(int p=0 ; p<nrFolds ; p++){
+      if(p != f)
+	foldTraining[f].push_back(people[p]);
+    }
+  }
+  
+  // The codebooks of fold f are codebooks[f*nrK .. f*nrK + nrK - 1]
+  bdd.changeKMSettings("specifical", ks[nrK-1], "training.means");
+  std::vector<KMcodebook*> codebooks;
+  std::vector<KMpca*> pcas;
+  for(int f=0 ; f<nrFolds ; f++){
+    std::cout << "Codebooks without " << people[f] << std::endl;
+    im_create_sweep_codebooks(bdd, foldTraining[f], ks, codebooks);
+    KMpca* pca = im_load_pca(bdd);
+    for(int j=0 ; j<nrK ; j++)
+      pcas.push_back(pca);
+  }
+  std::cout << "Computing the BOWs of all the folds and all the k..." << std::endl;
+  std::vector<std::map<std::string, struct svm_problem> > foldBOW;
+  double quantTimes[nrFolds*nrK];
+  im_compute_bdd_bows(bdd, codebooks, pcas, foldBOW, quantTimes);
+  int nrVideos = 0;
+  for(int p=0 ; p<nrFolds ; p++)
+    nrVideos += foldBOW[0][people[p]].l;
+  for(int c=0 ; c<nrFolds*nrK ; c++){
+    delete codebooks[c];
+    if(c%nrK == 0)
+      delete pcas[c];
+  }
+  
+  // The models of each fold are saved in its folder
+  std::vector<IMbdd> foldBdd(nrFolds, bdd);
+  std::vector<double> cvAccuracy(nrK), tauTrain(nrK), tauTest(nrK), modelSize(nrK), msPerVideo(nrK);
+  for(int j=0 ; j<nrK ; j++){
+    bdd.changeKMSettings("specifical", ks[j], "training.means");
+    for(int f=0 ; f<nrFolds ; f++){
+      foldBdd[f] = bdd;
+      im_set_fold_folder(foldBdd[f], people[f]);
+    }
+    MatrixC trainMC = MatrixC(nrActivities,labels);
+    MatrixC testMC = MatrixC(nrActivities,labels);
+    cvAccuracy[j] = 0;
+    modelSize[j] = 0;
+    msPerVideo[j] = 0;
+    for(int f=0 ; f<nrFolds ; f++){
+      std::cout << "k=" << ks[j] << ": testing " << people[f] << std::endl;
+      int size = 0;
+      cvAccuracy[j] += im_svm_train(foldBdd[f],
+				    foldTraining[f], trainMC,
+				    foldTesting[f], testMC,
+				    foldBOW[f*nrK + j],
+				    &size);
+      modelSize[j] += size;
+      msPerVideo[j] += quantTimes[f*nrK + j];
+    }
+    cvAccuracy[j] /= nrFolds;
+    modelSize[j] /= nrFolds;
+    msPerVideo[j] = (nrVideos > 0) ? msPerVideo[j]*1000/(nrFolds*nrVideos) : 0;
+    trainMC.calculFrequence();
+    testMC.calculFrequence();
+    tauTrain[j] = trainMC.recognitionRate*100;
+    tauTest[j] = testMC.recognitionRate*100;
+  }
+  for(int f=0 ; f<nrFolds ; f++)
+    im_remove_fold_folder(bdd, people[f]);
+  
+  std::stringstream table;
+  table << "# k\tcv_accuracy\ttau_train(%)\ttau_test(%)\tmult-adds/descriptor\tquantization(ms/video)\tmodel_size" << std::endl;
+  for(int j=0 ; j<nrK ; j++)
+    table << ks[j] << "\t" << cvAccuracy[j] << "\t" << tauTrain[j] << "\t" << tauTest[j]
+	  << "\t" << ks[j]*bdd.getCodebookDim() << "\t" << msPerVideo[j]
+	  << "\t" << modelSize[j] << std::endl;
+  std::string file(path2bdd + "/k_sweep.txt");
+  std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc);
+  if(!out){
+    std::cerr << "Impossible to open the file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  out << table.str();
+  out.close();
+  
+  std::cout << "#######################################" << std::endl;
+  std::cout << "######## RESUME OF THE K SWEEP ########" << std::endl;
+  std::cout << "#######################################" << std::endl;
+  std::cout << "Number of people: " << people.size() << std::endl;
+  std::cout << "Descriptor ID: " << bdd.getDescriptor() << std::endl;
+  std::cout << "PCA dimension: " << bdd.getCodebookDim() << "/" << bdd.getDim() << std::endl;
+  std::cout << "Number of test BOWs: " << nrVideos << std::endl;
+  std::cout << "Duration of the sweep: " << difftime(time(NULL),start) << "s" << std::endl;
+  std::cout << table.str();
+  std::cout << "(exported in " << file << ")" << std::endl;
+}
+
+/**
+ * \fn static double im_linear_leave_one_out(const IMbdd& bdd, const std::vector<struct svm_node*>& x, const std::vector<double>& y, const std::vector<int>& first, int minC, int maxC, struct svm_parameter& svmParameter)
+ * \brief Searches the best C of the linear models (bdd.getMapOrder() > 0)
+ * by leave-one-person-out: the BOWs are mapped once, then each fold
+ * trains the whole C path (increasing C) by dual coordinate descent, every
+ * C starting from the solution of the previous one. The folds run
+ * concurrently.
+ *
+ * \param[in] x,y The BOWs of the training people, person after person.
+ * \param[in] first The first BOW of each person (and the number of BOWs).
+ * \param[in,out] svmParameter The parameters, whose C is set.
+ * \return The cross validation accuracy of the best C.
+ */
+static double im_linear_leave_one_out(const IMbdd& bdd,
+				      const std::vector<struct svm_node*>& x,
+				      const std::vector<double>& y,
+				      const std::vector<int>& first,
+				      int minC, int maxC,
+				      struct svm_parameter& svmParameter){
+  int nrPeople = first.size() - 1;
+  int nrBOW = x.size();
+  int nrC = maxC - minC + 1;
+  struct svm_problem all;
+  all.l = nrBOW;
+  all.x = const_cast<struct svm_node**>(&x[0]);
+  all.y = const_cast<double*>(&y[0]);
+  std::vector<double> labels(get_labels_from_prob(&all));
+  int nrActivities = labels.size();
+  
+  std::cout << "Mapping the " << nrBOW << " training BOWs..." << std::endl;
+  AdditiveKernelMap kernelMap(svmParameter.kernel_type, bdd.getK(), bdd.getMapOrder());
+  int dim = kernelMap.getDim();
+  float* psi = new float[(size_t) nrBOW*dim];
+  kernelMap.map(&x[0], nrBOW, psi);
+  
+  // The correct predictions of each (C, fold)
+  std::vector<int> foldCorrect(nrC*nrPeople, 0);
+#pragma omp parallel for schedule(dynamic,1)
+  for(int p=0 ; p<nrPeople ; p++){
+    std::vector<int> rows;
+    for(int i=0 ; i<nrBOW ; i++)
+      if(i < first[p] || i >= first[p+1])
+	rows.push_back(i);
+    LinearOvrPredictor models(svmParameter.kernel_type, bdd.getK(),
+			      bdd.getMapOrder(), labels);
+    std::vector<double> alpha(rows.size()*nrActivities, 0);
+    int nrTests = first[p+1] - first[p];
+    std::vector<double> predicted(nrTests);
+    for(int c=0 ; c<nrC ; c++){
+      struct svm_parameter pathParameter = svmParameter;
+      pathParameter.C = pow(2,minC + c);
+      models.train(psi, rows, &y[0], pathParameter, &alpha[0]); // warm start
+      if(nrTests > 0)
+	models.predictBatch(psi + (size_t) first[p]*dim, nrTests, &predicted[0], NULL, 2);
+      for(int i=first[p] ; i<first[p+1] ; i++)
+	if(predicted[i - first[p]] == y[i])
+	  foldCorrect[c*nrPeople + p]++;
+    }
+  }
+  delete[] psi;
+  
+  // The first C wins a tie, as in the serial search
+  int bestC = 0, bestCorrect = -1;
+  for(int c=0 ; c<nrC ; c++){
+    int correct = 0;
+    for(int p=0 ; p<nrPeople ; p++)
+      correct += foldCorrect[c*nrPeople + p];
+    if(correct > bestCorrect){
+      bestCorrect = correct;
+      bestC = c;
+    }
+  }
+  std::cout << "Linear models: " << nrC*nrPeople*nrActivities
+	    << " trainings with warm starts along C" << std::endl;
+  svmParameter.C = pow(2,minC + bestC);
+  return bestCorrect * 1.0 / nrBOW;
+}
+
+/**
+ * \fn double im_training_leave_one_out(const IMbdd& bdd, const std::vector<std::string>& trainingPeople, const std::map<std::string, struct svm_problem>& peopleBOW, int& minC, int& maxC, int& minG, int& maxG, struct svm_parameter& svmParameter)
+ * \brief Searches the best C and gamma (2^C and 2^gamma) by
+ * leave-one-person-out on the training people.
+ *
+ * The search is a successive halving: all the candidates (C, gamma) are
+ * first scored on a few folds (the first people), then only the best
+ * 1/IM_HALVING_ETA of them are scored on more folds, and so on until the
+ * last candidates are scored on all the folds (their scores on the folds
+ * already done are kept). With IM_HALVING_ETA = 1 the whole grid is
+ * scored on all the folds. The number of SVM trainings saved compared
+ * with the whole grid is displayed.
+ *
+ * The Gram matrix of all the training BOWs is computed once (its gamma
+ * independent part, see svm_gram_base): every SVM of the grid (each fold,
+ * C and OVR class) is trained on a submatrix of it (PRECOMPUTED kernel)
+ * instead of evaluating the kernel again. The gamma axis is skipped
+ * (maxG = minG) if the kernel does not use gamma.
+ * With bdd.getMapOrder() > 0 only C is searched, for the linear
+ * models (see im_linear_leave_one_out).
+ *
+ * For each gamma, the (fold, OVR class) trainings are independent jobs run
+ * concurrently: each one goes along the increasing C and starts each SMO
+ * from the solution of the previous C, clipped to the new box (see
+ * svm_train_warm), which saves most of the iterations. Each (fold, C) test
+ * counts its correct predictions apart and the candidates are ranked in the
+ * order of the serial search (the first one wins a tie), so the result
+ * does not depend on the number of threads.
+ *
+ * \param[in,out] minC,maxC The range of ln2(C).
+ * \param[in,out] minG,maxG The range of ln2(gamma).
+ * \param[in,out] svmParameter The parameters, whose C and gamma are set.
+ * \return The cross validation accuracy of the best candidate.
+ */
 double im_training_leave_one_out(const IMbdd& bdd,
 				 const std::vector<std::string>& trainingPeople,
 				 const std::map <std::string, struct svm_problem>& peopleBOW,
@@ -991,68 +1966,172 @@ double im_training_leave_one_out(const IMbdd& bdd,
     exit(EXIT_FAILURE);
   }
   int nrActivities = bdd.getActivities().size();
-  std::string path2bdd(bdd.getFolder());
-  int C, gamma;
-  int bestC, bestG;
-  double bestAccuracy = -1;
-  for(C=minC; C<=maxC ; C++){
-    for(gamma = minG ; gamma <= maxG ; gamma++){
-      svmParameter.C = pow(2,C);
-      svmParameter.gamma = pow(2,gamma);
-      double XValidationAccuracy;
-      int total_correct = 0;
-      int nrBOW = 0;
-      // For each couple (C,gamma) we do people.size() leave one outs
-      for(std::vector<std::string>::const_iterator person = trainingPeople.begin();
-	  person != trainingPeople.end();
-	  ++person){
-	// This person will be the testing person
+  int nrPeople = trainingPeople.size();
+  
+  // All the BOWs of the training people, person after person
+  std::vector<struct svm_node*> x;
+  std::vector<double> y;
+  std::vector<int> first(nrPeople + 1, 0);
+  for(int p=0 ; p<nrPeople ; p++){
+    const struct svm_problem& bows = peopleBOW.at(trainingPeople[p]);
+    for(int i=0 ; i<bows.l ; i++){
+      x.push_back(bows.x[i]);
+      y.push_back(bows.y[i]);
+    }
+    first[p+1] = x.size();
+  }
+  int nrBOW = x.size();
+  if(!svm_kernel_uses_gamma(svmParameter.kernel_type))
+    maxG = minG; // the same SVMs for all the gammas
+  if(bdd.getMapOrder() > 0)
+    return im_linear_leave_one_out(bdd, x, y, first, minC, maxC, svmParameter);
+  
+  std::cout << "Computing the Gram matrix of the " << nrBOW << " training BOWs..." << std::endl;
+  double* base = svm_gram_base(&x[0], nrBOW, svmParameter);
+  double* gram = new double[(size_t) nrBOW*nrBOW];
+  struct svm_parameter precomputed = svmParameter;
+  precomputed.kernel_type = PRECOMPUTED;
+  int nrC = maxC - minC + 1;
+  int nrG = maxG - minG + 1;
+  
+  // The candidates are the cells (C - minC)*nrG + gamma - minG, in the
+  // order of the serial search
+  std::vector<int> candidates;
+  for(int cell=0 ; cell<nrC*nrG ; cell++)
+    candidates.push_back(cell);
+  // The number of rungs of the successive halving and the number of folds
+  // of each rung (the last one has all of them)
+  int nrRungs = 1;
+  if(IM_HALVING_ETA > 1)
+    for(int n=candidates.size() ; n > IM_HALVING_ETA ; n = (n + IM_HALVING_ETA - 1)/IM_HALVING_ETA)
+      nrRungs++;
+  std::vector<int> rungFolds(nrRungs, nrPeople);
+  for(int r=nrRungs-2 ; r>=0 ; r--){
+    rungFolds[r] = (rungFolds[r+1] + IM_HALVING_ETA - 1)/IM_HALVING_ETA;
+    if(rungFolds[r] < IM_HALVING_MIN_FOLDS)
+      rungFolds[r] = (IM_HALVING_MIN_FOLDS < nrPeople) ? IM_HALVING_MIN_FOLDS : nrPeople;
+  }
+  
+  // The correct predictions of each (cell, fold)
+  std::vector<int> foldCorrect(nrC*nrG*nrPeople, 0);
+  std::vector<struct svm_problem> trainingProblems(nrPeople);
+  std::vector<std::vector<struct svm_node*> > testingRows(nrPeople);
+  int nrTrainings = 0;
+  int doneFolds = 0;
+  for(int r=0 ; r<nrRungs ; r++){
+    int newFolds = rungFolds[r];
+    if(newFolds > doneFolds){
+      for(int gamma = minG ; gamma <= maxG ; gamma++){
+	// The candidates of this gamma
+	std::vector<int> cells;
+	for(unsigned int c=0 ; c<candidates.size() ; c++)
+	  if(candidates[c]%nrG == gamma - minG)
+	    cells.push_back(candidates[c]);
+	if(cells.size() == 0)
+	  continue;
+	int nrCells = cells.size();
+	svmParameter.gamma = pow(2,gamma);
+	svm_gram_kernel(base, nrBOW, svmParameter, gram);
+	// The folds are the people doneFolds to newFolds - 1
+#pragma omp parallel for schedule(dynamic,1)
+	for(int p=doneFolds ; p<newFolds ; p++){
+	  // This person will be the testing person, we do the training with the others
+	  std::vector<int> rows;
+	  for(int i=0 ; i<nrBOW ; i++)
+	    if(i < first[p] || i >= first[p+1])
+	      rows.push_back(i);
+	  trainingProblems[p] = svm_precomputed_problem(gram, nrBOW, rows, &y[0]);
+	  for(int i=first[p] ; i<first[p+1] ; i++)
+	    testingRows[p].push_back(svm_precomputed_row(gram, nrBOW, i, rows));
+	}
 	
-	// We do the training with the others
-	struct svm_problem trainingProblem;
-	trainingProblem.l = 0;
-	trainingProblem.x = NULL;
-	trainingProblem.y = NULL;
-	for(std::vector<std::string>::const_iterator trainingPerson = trainingPeople.begin();
-	    trainingPerson != trainingPeople.end();
-	    ++ trainingPerson){
-	  // Training with the other person
-	  if((*trainingPerson).compare(*person) != 0){
-	    // For each person we train the rest and we test the person
-	    // Then compute the mean of the cross validation accuracy 
-	    for(int i=0 ; i < peopleBOW.at(*trainingPerson).l ; i++){
-	      struct svm_node* bow = peopleBOW.at(*trainingPerson).x[i];
-	      addBOW(bow, peopleBOW.at(*trainingPerson).y[i],trainingProblem);
-	    }
+	// The (fold, OVR class) jobs are independent: each one trains its SVMs
+	// along the increasing C of the cells, every SVM starting from the
+	// solution of the previous C (warm start)
+	int nrJobs = (newFolds - doneFolds)*nrActivities;
+	std::vector<struct svm_model*> svmModels((size_t) nrJobs*nrCells);
+#pragma omp parallel for schedule(dynamic,1)
+	for(int job=0 ; job<nrJobs ; job++){
+	  int p = doneFolds + job/nrActivities;
+	  int l = trainingProblems[p].l;
+	  double label = get_labels_from_prob(&trainingProblems[p])[job%nrActivities];
+	  std::vector<double> alpha(l, 0), G(l, 0); // cold start
+	  for(int c=0 ; c<nrCells ; c++){
+	    struct svm_parameter jobParameter = precomputed;
+	    jobParameter.C = pow(2,minC + cells[c]/nrG);
+	    svmModels[(size_t) job*nrCells + c] =
+	      svm_train_ovr_class(&trainingProblems[p],&jobParameter,label,&alpha[0],&G[0]);
 	  }
 	}
-	struct svm_model** svmModels = svm_train_ovr(&trainingProblem,&svmParameter);
-	destroy_svm_problem(trainingProblem);
 	
-	// Making test
-	for(int i=0 ; i<peopleBOW.at(*person).l ; i++){
-	  double* probs = new double[nrActivities];
-	  double lab_in = peopleBOW.at(*person).y[i];
-	  double lab_out = svm_predict_ovr_probs(svmModels,peopleBOW.at(*person).x[i],
-						 nrActivities,probs,2);
-	  delete []probs;
-	  if(lab_in == lab_out)
-	    total_correct++;
-	  nrBOW++;
+	// Testing each (fold, C)
+#pragma omp parallel for schedule(dynamic,1)
+	for(int test=0 ; test<(newFolds - doneFolds)*nrCells ; test++){
+	  int p = doneFolds + test/nrCells;
+	  int c = test%nrCells;
+	  struct svm_model** foldModels = new struct svm_model*[nrActivities];
+	  for(int a=0 ; a<nrActivities ; a++)
+	    foldModels[a] = svmModels[((size_t) (p - doneFolds)*nrActivities + a)*nrCells + c];
+	  OvrPredictor predictor(foldModels, nrActivities);
+	  
+	  // Making test
+	  int nrTests = first[p+1] - first[p];
+	  std::vector<double> predicted(nrTests);
+	  if(nrTests > 0)
+	    predictor.predictBatch(&testingRows[p][0], nrTests, &predicted[0], NULL, 2);
+	  int& correct = foldCorrect[cells[c]*nrPeople + p];
+	  for(int i=first[p] ; i<first[p+1] ; i++)
+	    if(y[i] == predicted[i - first[p]])
+	      correct++;
+	  // Releasing svmModels memory
+	  for(int a=0 ; a<nrActivities ; a++){
+	    svm_free_and_destroy_model(&foldModels[a]);
+	  }
+	  delete[] foldModels;
 	}
-	// Releasing svmModels memory
-	for(int i=0 ; i<nrActivities ; i++){
-	  svm_free_and_destroy_model(&svmModels[i]);
+	nrTrainings += (newFolds - doneFolds)*nrCells*nrActivities;
+	
+	for(int p=doneFolds ; p<newFolds ; p++){
+	  for(unsigned int i=0 ; i<testingRows[p].size() ; i++)
+	    free(testingRows[p][i]);
+	  testingRows[p].clear();
+	  destroy_svm_problem(trainingProblems[p]); // after the models (they point to it)
 	}
-	delete[] svmModels;
-      } // leave one out
-      if((XValidationAccuracy = total_correct * 1.0 / nrBOW) > bestAccuracy){
-	bestAccuracy = XValidationAccuracy;
-	bestC = C;
-	bestG = gamma;
-      }
-    } // gamma loop 
-  } // C loop
+      } // gamma loop
+      doneFolds = newFolds;
+    }
+    
+    // Keeping the best candidates (stable: the serial order breaks the ties)
+    std::vector<std::pair<int, int> > scores; // (-correct, position)
+    for(unsigned int c=0 ; c<candidates.size() ; c++){
+      int correct = 0;
+      for(int p=0 ; p<doneFolds ; p++)
+	correct += foldCorrect[candidates[c]*nrPeople + p];
+      scores.push_back(std::make_pair(-correct, (int) c));
+    }
+    std::sort(scores.begin(), scores.end());
+    int nrKept = (r == nrRungs-1) ? 1 : (candidates.size() + IM_HALVING_ETA - 1)/IM_HALVING_ETA;
+    std::vector<int> kept;
+    for(int c=0 ; c<nrKept ; c++)
+      kept.push_back(scores[c].second);
+    std::sort(kept.begin(), kept.end());
+    for(int c=0 ; c<nrKept ; c++)
+      kept[c] = candidates[kept[c]];
+    candidates = kept;
+  }
+  delete[] base;
+  delete[] gram;
+  
+  int bestCell = candidates[0];
+  int bestC = minC + bestCell/nrG, bestG = minG + bestCell%nrG;
+  int bestCorrect = 0;
+  for(int p=0 ; p<nrPeople ; p++)
+    bestCorrect += foldCorrect[bestCell*nrPeople + p];
+  double bestAccuracy = bestCorrect * 1.0 / nrBOW;
+  int gridTrainings = nrC*nrG*nrPeople*nrActivities;
+  std::cout << "Successive halving (" << nrRungs << " rungs): " << nrTrainings
+	    << " SVM trainings instead of " << gridTrainings << " ("
+	    << gridTrainings - nrTrainings << " saved)" << std::endl;
   svmParameter.C = pow(2,bestC);
   svmParameter.gamma = pow(2,bestG);
   
@@ -1064,15 +2143,39 @@ double im_svm_train(IMbdd& bdd,
 		    MatrixC& trainMC,
 		    const std::vector<std::string>& testingPeople,
 		    MatrixC& testMC){
-  std::string path2bdd(bdd.getFolder());
-  int k = bdd.getK();
-  
   // Computing Bag Of Words for each people
   std::cout << "Computing BOWs..." << std::endl;
   std::map<std::string, struct svm_problem> peopleBOW;
-  std::map<std::string, int> activitiesLabel;
   std::cout << "Computing the SVM problem (ie. BOW) of all the people..." << std::endl;
   im_compute_bdd_bow(bdd,peopleBOW); // all the BOW are saved in peopleBOW
+  return im_svm_train(bdd,
+		      trainingPeople, trainMC,
+		      testingPeople, testMC,
+		      peopleBOW);
+}
+
+/**
+ * \fn double im_svm_train(IMbdd& bdd, const std::vector<std::string>& trainingPeople, MatrixC& trainMC, const std::vector<std::string>& testingPeople, MatrixC& testMC, std::map<std::string, struct svm_problem>& peopleBOW, int* modelSize)
+ * \brief Trains the SVMs on BOWs already computed with the codebook of the
+ * training people, and tests them.
+ *
+ * \param[in,out] peopleBOW The (not normalized) BOWs of all the people.
+ * They are normalized, then released.
+ * \param[out] modelSize If not NULL, the size of the trained models: the
+ * number of support vectors of all the OVR kernel models, or the dimension
+ * of the feature map of the linear models.
+ * \return The cross validation accuracy.
+ */
+double im_svm_train(IMbdd& bdd,
+		    const std::vector<std::string>& trainingPeople,
+		    MatrixC& trainMC,
+		    const std::vector<std::string>& testingPeople,
+		    MatrixC& testMC,
+		    std::map<std::string, struct svm_problem>& peopleBOW,
+		    int* modelSize){
+  std::string path2bdd(bdd.getFolder());
+  int k = bdd.getK();
+  
   // Normalization: do not forget to change the normalization before this step
   //bdd.changeNormalizationSettings(normalization,
   //				      "means.txt",
@@ -1085,9 +2188,10 @@ double im_svm_train(IMbdd& bdd,
   }
   
   std::cout << "Normalizing the BOW..." << std::endl; 
+  std::string prefix(im_artifact_prefix(bdd));
   bdd.changeNormalizationSettings("simple",
-				  "means.txt",
-				  "stand_devia.txt");
+				  prefix + "means.txt",
+				  prefix + "stand_devia.txt");
   im_normalize_bdd_bow(bdd,trainingPeople,peopleBOW); 
   
   std::cout << "Not exporting the problem..." << std::endl;
@@ -1117,63 +2221,90 @@ double im_svm_train(IMbdd& bdd,
   
   // Generating the SVM model
   std::cout << "Generating the SVM model..." << std::endl;
-  struct svm_problem trainingProblem;
-  trainingProblem.l = 0;
-  trainingProblem.x = NULL;
-  trainingProblem.y = NULL;
+  SvmProblemBuilder trainingBuilder;
   for(std::vector<std::string>::const_iterator trainingPerson = trainingPeople.begin();
       trainingPerson != trainingPeople.end();
-      ++ trainingPerson){
-    for(int i=0 ; i < peopleBOW.at(*trainingPerson).l ; i++){
-      struct svm_node* bow = peopleBOW.at(*trainingPerson).x[i];
-      addBOW(bow, peopleBOW.at(*trainingPerson).y[i],trainingProblem);
-    }
-  }
+      ++ trainingPerson)
+    trainingBuilder.addProblem(peopleBOW.at(*trainingPerson));
+  struct svm_problem trainingProblem = trainingBuilder.build();
   
-  struct svm_model** svmModels = svm_train_ovr(&trainingProblem,&svmParameter);
-  
-  // Exporting models
-  std::cout << "Saving the SVM model..." << std::endl;
-  std::vector <std::string> modelFiles;
   int nrActivities = bdd.getActivities().size();
-  for(int i=0 ; i< nrActivities ; i++){
-    std::string fileToSaveModel = path2bdd;
-    std::stringstream ss;
-    ss << i;
-    fileToSaveModel = fileToSaveModel + "/svm_ovr_" + ss.str() + ".model";
-    svm_save_model(fileToSaveModel.c_str(),svmModels[i]);
-    modelFiles.push_back(fileToSaveModel);
+  struct svm_model** svmModels = NULL;
+  LinearOvrPredictor* linear = NULL;
+  std::vector <std::string> modelFiles;
+  if(bdd.getMapOrder() > 0){
+    // Only linear models (no SVM model file)
+    linear = svm_train_linear_ovr(&trainingProblem,&svmParameter,k,
+				  bdd.getMapOrder());
+  }
+  else{
+    svmModels = svm_train_ovr(&trainingProblem,&svmParameter);
+    
+    // Exporting models
+    std::cout << "Saving the SVM model..." << std::endl;
+    for(int i=0 ; i< nrActivities ; i++){
+      std::string fileToSaveModel = path2bdd;
+      std::stringstream ss;
+      ss << i;
+      fileToSaveModel = fileToSaveModel + "/" + prefix + "svm_ovr_" + ss.str() + ".model";
+      svm_save_model(fileToSaveModel.c_str(),svmModels[i]);
+      modelFiles.push_back(fileToSaveModel);
+    }
+    // The CHIS and INTERS models are also exported as linear models if the
+    // BDD predicts with the approximation (see im_set_approximation)
+    if(bdd.getApproxPrediction() &&
+       (svmParameter.kernel_type == CHIS || svmParameter.kernel_type == INTERS))
+      linear = new LinearOvrPredictor(svmModels, nrActivities, k);
   }
   bdd.changeSVMSettings(nrActivities,
 			modelFiles);
+  if(modelSize){
+    *modelSize = 0;
+    if(svmModels){
+      for(int i=0 ; i<nrActivities ; i++)
+	*modelSize += svmModels[i]->l;
+    }
+    else
+      *modelSize = linear->getMap().getDim();
+  }
+  // The linear models are used by the recognition (the file of previous
+  // linear models is removed with the exact kernel models)
+  std::string linearFile(path2bdd + "/" + prefix + "svm_ovr_linear.map");
+  if(linear)
+    linear->exportModels(linearFile);
+  else
+    remove(linearFile.c_str());
   
   // Calculate the confusion matrix and the probability estimation
   std::cout << "Filling the training confusion matrix..." << std::endl;
-  im_fill_confusion_matrix(bdd,trainingProblem,svmModels, trainMC);
-  destroy_svm_problem(trainingProblem);
+  if(svmModels)
+    im_fill_confusion_matrix(bdd,trainingProblem,svmModels, trainMC);
+  else
+    im_fill_confusion_matrix(bdd,trainingProblem,*linear, trainMC);
+  OvrPredictor* exact = (svmModels && linear) ? new OvrPredictor(svmModels, nrActivities) : NULL;
+  if(exact)
+    svm_compare_linear(*exact, *linear, trainingProblem);
   
   if(testingPeople.size() > 0){
-    std::cerr << "Entering in Hell..." << std::endl;
-    struct svm_problem testingProblem;
-    trainingProblem.l = 0;
-    trainingProblem.x = NULL;
-    trainingProblem.y = NULL;
+    SvmProblemBuilder testingBuilder;
     for(std::vector<std::string>::const_iterator testingPerson = testingPeople.begin();
 	testingPerson != testingPeople.end();
-	++ testingPerson){
-      for(int i=0 ; i < peopleBOW.at(*testingPerson).l ; i++){
-	std::cerr << "HELlllll" << std::endl;
-	struct svm_node* bow = peopleBOW.at(*testingPerson).x[i];
-	std::cerr << peopleBOW.at(*testingPerson).y[i] << std::endl;
-	std::cerr << "YOOOO man" << std::endl;
-	addBOW(bow, peopleBOW.at(*testingPerson).y[i],testingProblem);
-	std::cerr << "Why ?!!!" << std::endl;
-      }
-    }
+	++ testingPerson)
+      testingBuilder.addProblem(peopleBOW.at(*testingPerson));
+    struct svm_problem testingProblem = testingBuilder.build();
     std::cout << "Filling the testing confusion matrix..." << std::endl;
-    im_fill_confusion_matrix(bdd,testingProblem,svmModels, testMC);
+    if(svmModels)
+      im_fill_confusion_matrix(bdd,testingProblem,svmModels, testMC);
+    else
+      im_fill_confusion_matrix(bdd,testingProblem,*linear, testMC);
+    if(exact)
+      svm_compare_linear(*exact, *linear, testingProblem);
     destroy_svm_problem(testingProblem);
   }
+  delete exact;
+  delete linear;
+  // The support vectors of the models point to the training problem
+  destroy_svm_problem(trainingProblem);
   
   std::cout << "Releasing peopleBOW" << std::endl;
   // Releasing peopleBOW
@@ -1185,31 +2316,74 @@ double im_svm_train(IMbdd& bdd,
   }
   
   // Releasing OVR models
-  for(int i=0;i<nrActivities;i++){
-    svm_free_and_destroy_model(&svmModels[i]);}
-  delete [] svmModels;
-  svmModels = NULL;
+  if(svmModels){
+    for(int i=0;i<nrActivities;i++){
+      svm_free_and_destroy_model(&svmModels[i]);}
+    delete [] svmModels;
+    svmModels = NULL;
+  }
   
   return crossValidationAccuracy;
 }
 void im_compute_bdd_bow(const IMbdd& bdd, 
 			std::map <std::string, struct svm_problem>& peopleBOW){
+  // The codebook (and the PCA) is loaded once for all the videos
+  std::vector<KMcodebook*> codebooks(1, im_load_codebook(bdd));
+  std::vector<KMpca*> pcas(1, im_load_pca(bdd));
+  std::vector<std::map<std::string, struct svm_problem> > peopleBOWs;
+  im_compute_bdd_bows(bdd, codebooks, pcas, peopleBOWs);
+  peopleBOW.insert(peopleBOWs[0].begin(), peopleBOWs[0].end());
+  delete codebooks[0];
+  delete pcas[0];
+}
+
+/**
+ * \fn void im_compute_bdd_bows(const IMbdd& bdd, const std::vector<KMcodebook*>& codebooks, const std::vector<KMpca*>& pcas, std::vector<std::map<std::string, struct svm_problem> >& peopleBOWs, double* quantTimes)
+ * \brief Computes the BOWs of all the videos of the BDD with several
+ * codebooks (the ones of the leave-one-person-out folds) in a single pass:
+ * each file is read once and its descriptors are quantized with every
+ * codebook (concurrently, unless the quantization times are measured).
+ *
+ * \param[in] bdd The BDD.
+ * \param[in] codebooks The codebooks.
+ * \param[in] pcas The PCA of each codebook (NULL if there is none).
+ * \param[out] peopleBOWs For each codebook, the BOWs of each person.
+ * \param[out] quantTimes If not NULL, the time (in seconds) spent in the
+ * quantization with each codebook. The codebooks then quantize one after
+ * the other, so that each time is the one of the codebook alone.
+ *
+ * Consecutive codebooks with the same PCA share the projection of the
+ * descriptors.
+ */
+void im_compute_bdd_bows(const IMbdd& bdd,
+			 const std::vector<KMcodebook*>& codebooks,
+			 const std::vector<KMpca*>& pcas,
+			 std::vector<std::map<std::string, struct svm_problem> >& peopleBOWs,
+			 double* quantTimes){
   std::string path2bdd(bdd.getFolder());
   std::vector<std::string> activities = bdd.getActivities();
   std::vector<std::string> people = bdd.getPeople();
 
   int dim = bdd.getDim();
   int maxPts = bdd.getMaxPts();
-  int k = bdd.getK();
+  int nrCodebooks = codebooks.size();
+  peopleBOWs.resize(nrCodebooks);
+  // The codebooks sharing a PCA (the ones of a k sweep) use the same
+  // projection: the one of the first of them
+  std::vector<int> firstPCA(nrCodebooks);
+  for(int c=0 ; c<nrCodebooks ; c++){
+    firstPCA[c] = c;
+    while(firstPCA[c] > 0 && pcas[firstPCA[c] - 1] == pcas[c])
+      firstPCA[c]--;
+    if(quantTimes)
+      quantTimes[c] = 0;
+  }
   
   for(std::vector<std::string>::iterator person = people.begin();
       person != people.end();
       ++person){
     int currentActivity = 1;
-    struct svm_problem svmPeopleBOW;
-    svmPeopleBOW.l = 0;
-    svmPeopleBOW.x = NULL;
-    svmPeopleBOW.y = NULL;
+    std::vector<SvmProblemBuilder> svmPeopleBOW(nrCodebooks);
     std::cout << "Computing the svmProblem of " << *person << std::endl;
     for(std::vector<std::string>::iterator activity = activities.begin();
 	activity != activities.end();
@@ -1229,42 +2403,53 @@ void im_compute_bdd_bow(const IMbdd& bdd,
 	  int nPts = importSTIPs(path2FPs, dim, maxPts, &dataPts);
 	  if(nPts != 0){
 	    dataPts.setNPts(nPts);
-	    dataPts.buildKcTree();
 	    
-	    KMfilterCenters ctrs(k, dataPts);
-	    importCenters(path2bdd + "/" + "training.means", dim, k, &ctrs);
+	    // The descriptors are projected once per PCA
+	    std::vector<KMdata*> projected(nrCodebooks, (KMdata*) NULL);
+#pragma omp parallel for schedule(dynamic,1) if(nrCodebooks > 1)
+	    for(int c=0 ; c<nrCodebooks ; c++){
+	      if(pcas[c] && firstPCA[c] == c){
+		projected[c] = new KMdata(pcas[c]->getOutDim(), nPts);
+		pcas[c]->project(dataPts, *projected[c]);
+	      }
+	    }
 	    
-	    // Only one BOW
-	    struct svm_problem svmBow = computeBOW(currentActivity,
-						   dataPts,
-						   ctrs);
-	    addBOW(svmBow.x[0], svmBow.y[0], svmPeopleBOW);
-	    destroy_svm_problem(svmBow);	  
+	    // Only one BOW per codebook
+	    std::vector<struct svm_problem> svmBow(nrCodebooks);
+#pragma omp parallel for schedule(dynamic,1) if(nrCodebooks > 1 && !quantTimes)
+	    for(int c=0 ; c<nrCodebooks ; c++){
+	      double t = omp_get_wtime();
+	      svmBow[c] = computeBOW(currentActivity,
+				     pcas[c] ? *projected[firstPCA[c]] : dataPts,
+				     *codebooks[c]);
+	      if(quantTimes)
+		quantTimes[c] += omp_get_wtime() - t;
+	    }
+	    for(int c=0 ; c<nrCodebooks ; c++){
+	      svmPeopleBOW[c].addProblem(svmBow[c]);
+	      destroy_svm_problem(svmBow[c]);
+	      delete projected[c];
+	    }
 	  }
 	}
       }
       closedir(repertoire);
       currentActivity++;
     }
-    peopleBOW.insert(std::make_pair<std::string, struct svm_problem>((*person), svmPeopleBOW));
+    for(int c=0 ; c<nrCodebooks ; c++)
+      peopleBOWs[c].insert(std::make_pair<std::string, struct svm_problem>((*person), svmPeopleBOW[c].build()));
   }
 }
 void im_normalize_bdd_bow(const IMbdd& bdd, const std::vector<std::string>& trainingPeople,
 			  std::map<std::string, struct svm_problem>& peopleBOW){
   int k = bdd.getK();
   // Extract and export gaussian parameters
-  struct svm_problem svmProblem;
-  svmProblem.l = 0;
-  svmProblem.x = NULL;
-  svmProblem.y = NULL;
+  SvmProblemBuilder builder;
   for(std::vector<std::string>::const_iterator person = trainingPeople.begin();
       person != trainingPeople.end();
-      ++person){
-    for(int i=0 ; i<peopleBOW[*person].l ; i++){
-      svm_node *bow = peopleBOW[*person].x[i];
-      addBOW(bow, peopleBOW[*person].y[i],  svmProblem);
-    }
-  }
+      ++person)
+    builder.addProblem(peopleBOW[*person]);
+  struct svm_problem svmProblem = builder.build();
   double *means=NULL, *stand_devia=NULL;
   means = new double[k];
   stand_devia = new double[k];
@@ -1309,27 +2494,45 @@ void bow_normalization(const IMbdd& bdd, struct svm_problem& svmProblem){
   }
 }
 
-void im_fill_confusion_matrix(const IMbdd& bdd,
-			      const struct svm_problem& svmProblem,
-			      struct svm_model** svmModels,
-			      MatrixC& MC){
+// Predicts the BOWs of svmProblem with an OvrPredictor or a LinearOvrPredictor
+template <class Predictor>
+static void im_fill_confusion_matrix_with(const IMbdd& bdd,
+					  const struct svm_problem& svmProblem,
+					  Predictor& predictor,
+					  MatrixC& MC){
   int nrActivities = bdd.getActivities().size();
   double* py = svmProblem.y;
   int pnum = svmProblem.l;
-  struct svm_node** px = svmProblem.x;
+  std::vector<double> predicted(pnum);
+  std::vector<double> probs((size_t) pnum*nrActivities);
+  svm_predict_ovr_batch(predictor, svmProblem.x, pnum,
+			pnum > 0 ? &predicted[0] : NULL,
+			pnum > 0 ? &probs[0] : NULL, 2);
   for(int i=0 ; i<pnum ; i++){
-    double* probs = new double[nrActivities];
     double lab_in = py[i];
-    double lab_out = svm_predict_ovr_probs(svmModels,px[i],nrActivities,
-					   probs,2);
+    double lab_out = predicted[i];
 
     std::cout << "in=" << lab_in << " out=" << lab_out << std::endl;
     MC.addTransfer(lab_in,lab_out);
     std::cout << "Probs: ";
     for(int j=0; j<nrActivities; j++){
-      std::cout << setw(5) << setiosflags(ios::fixed) << probs[j]<<" "; 
+      std::cout << setw(5) << setiosflags(ios::fixed) << probs[(size_t) i*nrActivities + j]<<" "; 
     }
     std::cout << std::endl;
-    delete [] probs;
   }
 }
+
+void im_fill_confusion_matrix(const IMbdd& bdd,
+			      const struct svm_problem& svmProblem,
+			      struct svm_model** svmModels,
+			      MatrixC& MC){
+  OvrPredictor predictor(svmModels, bdd.getActivities().size());
+  im_fill_confusion_matrix_with(bdd, svmProblem, predictor, MC);
+}
+
+void im_fill_confusion_matrix(const IMbdd& bdd,
+			      const struct svm_problem& svmProblem,
+			      LinearOvrPredictor& predictor,
+			      MatrixC& MC){
+  im_fill_confusion_matrix_with(bdd, svmProblem, predictor, MC);
+}
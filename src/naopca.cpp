@@ -0,0 +1,299 @@
+/**
+ * \file naopca.cpp
+ * \brief Principal component analysis of the descriptors (dimension
+ * reduction ahead of the k-means and of the quantization).
+ * \author agent
+ * \date 19/10/2026
+ *
+ */
+#include "naopca.h"
+#include <fstream>
+#include <math.h>
+
+#define KM_JACOBI_MAX_SWEEPS 50
+
+/**
+ * \fn void kmSymmetricEigen(int n, double* A, double* eigenvalues, double* V)
+ * \brief Eigen decomposition of a symmetric matrix with the cyclic Jacobi
+ * method. The eigenvalues are sorted in decreasing order.
+ *
+ * \param[in] n The size of the matrix.
+ * \param[in,out] A The matrix (n x n, row-major). It is destroyed.
+ * \param[out] eigenvalues The n eigenvalues.
+ * \param[out] V The eigenvectors (n x n, row-major): the column j is the
+ * eigenvector of eigenvalues[j].
+ */
+void kmSymmetricEigen(int n, double* A, double* eigenvalues, double* V){
+  for(int i=0 ; i<n ; i++)
+    for(int j=0 ; j<n ; j++)
+      V[i*n + j] = (i == j) ? 1 : 0;
+
+  for(int sweep=0 ; sweep<KM_JACOBI_MAX_SWEEPS ; sweep++){
+    double offDiag = 0, diag = 0;
+    for(int p=0 ; p<n ; p++){
+      diag += fabs(A[p*n + p]);
+      for(int q=p+1 ; q<n ; q++)
+	offDiag += fabs(A[p*n + q]);
+    }
+    if(offDiag <= 1e-15*diag || offDiag == 0)
+      break;
+    for(int p=0 ; p<n ; p++){
+      for(int q=p+1 ; q<n ; q++){
+	double apq = A[p*n + q];
+	if(fabs(apq) <= 1e-300)
+	  continue;
+	// Rotation in the plane (p,q) zeroing A[p][q]
+	double theta = (A[q*n + q] - A[p*n + p])/(2*apq);
+	double t = 1/(fabs(theta) + sqrt(theta*theta + 1));
+	if(theta < 0) t = -t;
+	double c = 1/sqrt(t*t + 1);
+	double s = t*c;
+	for(int k=0 ; k<n ; k++){ // columns p and q
+	  double akp = A[k*n + p], akq = A[k*n + q];
+	  A[k*n + p] = c*akp - s*akq;
+	  A[k*n + q] = s*akp + c*akq;
+	}
+	for(int k=0 ; k<n ; k++){ // rows p and q
+	  double apk = A[p*n + k], aqk = A[q*n + k];
+	  A[p*n + k] = c*apk - s*aqk;
+	  A[q*n + k] = s*apk + c*aqk;
+	}
+	for(int k=0 ; k<n ; k++){
+	  double vkp = V[k*n + p], vkq = V[k*n + q];
+	  V[k*n + p] = c*vkp - s*vkq;
+	  V[k*n + q] = s*vkp + c*vkq;
+	}
+      }
+    }
+  }
+  for(int i=0 ; i<n ; i++)
+    eigenvalues[i] = A[i*n + i];
+
+  // Sorting (selection sort: n is the descriptors' dimension)
+  for(int i=0 ; i<n ; i++){
+    int m = i;
+    for(int j=i+1 ; j<n ; j++)
+      if(eigenvalues[j] > eigenvalues[m])
+	m = j;
+    if(m != i){
+      double tmp = eigenvalues[i]; eigenvalues[i] = eigenvalues[m]; eigenvalues[m] = tmp;
+      for(int k=0 ; k<n ; k++){
+	tmp = V[k*n + i]; V[k*n + i] = V[k*n + m]; V[k*n + m] = tmp;
+      }
+    }
+  }
+}
+
+/**
+ * \fn KMpca::KMpca(const KMdata& sample, int outDim, const double* weights)
+ * \brief Fits the PCA on a sample of descriptors.
+ *
+ * \param[in] sample The descriptors (at most KM_PCA_MAX_SAMPLE should be enough).
+ * \param[in] outDim The dimension of the projected descriptors.
+ * \param[in] weights The weights of the descriptors (a coreset), or NULL.
+ */
+KMpca::KMpca(const KMdata& sample, int outDim, const double* weights) :
+  inDim(sample.getDim()), outDim(outDim){
+  if(outDim < 1 || outDim > inDim){
+    std::cerr << "Bad PCA dimension: " << outDim << " (descriptors of dimension "
+	      << inDim << ")" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  int n = sample.getNPts();
+  if(n < 2){
+    std::cerr << "Not enough descriptors to fit the PCA!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  mean = new double[inDim];
+  W = new double[inDim*outDim];
+  eigenvalues = new double[inDim];
+
+  double totalWeight = 0;
+  for(int d=0 ; d<inDim ; d++)
+    mean[d] = 0;
+  for(int i=0 ; i<n ; i++){
+    double w = weights ? weights[i] : 1;
+    totalWeight += w;
+    for(int d=0 ; d<inDim ; d++)
+      mean[d] += w*sample[i][d];
+  }
+  for(int d=0 ; d<inDim ; d++)
+    mean[d] /= totalWeight;
+
+  // Covariance matrix (upper triangle, one partial matrix per thread)
+  double* cov = new double[inDim*inDim];
+  for(int i=0 ; i<inDim*inDim ; i++)
+    cov[i] = 0;
+#pragma omp parallel
+  {
+    double* partial = new double[inDim*inDim];
+    double* x = new double[inDim];
+    for(int i=0 ; i<inDim*inDim ; i++)
+      partial[i] = 0;
+#pragma omp for schedule(static)
+    for(int i=0 ; i<n ; i++){
+      double w = weights ? weights[i] : 1;
+      for(int d=0 ; d<inDim ; d++)
+	x[d] = sample[i][d] - mean[d];
+      for(int p=0 ; p<inDim ; p++){
+	double xp = w*x[p];
+	double* row = partial + p*inDim;
+	for(int q=p ; q<inDim ; q++)
+	  row[q] += xp*x[q];
+      }
+    }
+#pragma omp critical
+    for(int i=0 ; i<inDim*inDim ; i++)
+      cov[i] += partial[i];
+    delete[] partial;
+    delete[] x;
+  }
+  double norm = weights ? totalWeight : n - 1;
+  for(int p=0 ; p<inDim ; p++){
+    for(int q=p ; q<inDim ; q++){
+      cov[p*inDim + q] /= norm;
+      cov[q*inDim + p] = cov[p*inDim + q];
+    }
+  }
+
+  double* V = new double[inDim*inDim];
+  kmSymmetricEigen(inDim, cov, eigenvalues, V);
+  for(int d=0 ; d<inDim ; d++)
+    for(int r=0 ; r<outDim ; r++)
+      W[d*outDim + r] = V[d*inDim + r];
+  delete[] V;
+  delete[] cov;
+}
+
+/**
+ * \fn KMpca::KMpca(std::string file)
+ * \brief Imports a PCA saved by exportPCA: the first line is
+ * "inDim outDim", then the mean, the eigenvalues and the inDim rows of W.
+ *
+ * \param[in] file The file containing the PCA.
+ */
+KMpca::KMpca(std::string file){
+  std::ifstream in(file.c_str(), std::ios::in);
+  if(!in){
+    std::cerr << "Impossible to open the PCA file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if(!(in >> inDim >> outDim) || inDim < 1 || outDim < 1 || outDim > inDim){
+    std::cerr << "Bad header in the PCA file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  mean = new double[inDim];
+  W = new double[inDim*outDim];
+  eigenvalues = new double[inDim];
+  bool ok = true;
+  for(int d=0 ; d<inDim && ok ; d++)
+    ok = !(in >> mean[d]).fail();
+  for(int d=0 ; d<inDim && ok ; d++)
+    ok = !(in >> eigenvalues[d]).fail();
+  for(int i=0 ; i<inDim*outDim && ok ; i++)
+    ok = !(in >> W[i]).fail();
+  if(!ok){
+    std::cerr << "The PCA file " << file << " is truncated" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+KMpca::~KMpca(){
+  delete[] mean;
+  delete[] W;
+  delete[] eigenvalues;
+}
+
+/**
+ * \fn double KMpca::getExplainedVariance()
+ * \brief Gives the part of the variance kept by the projection.
+ */
+double KMpca::getExplainedVariance() const{
+  double kept = 0, total = 0;
+  for(int d=0 ; d<inDim ; d++){
+    double v = (eigenvalues[d] > 0) ? eigenvalues[d] : 0;
+    total += v;
+    if(d < outDim) kept += v;
+  }
+  return (total > 0) ? kept/total : 1;
+}
+
+/**
+ * \fn void KMpca::exportPCA(std::string file)
+ * \brief Exports the PCA (see the constructor importing it).
+ *
+ * \param[in] file The file which will be containing the PCA.
+ */
+void KMpca::exportPCA(std::string file) const{
+  std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc);
+  if(!out){
+    std::cerr << "Impossible to open the file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  out.precision(17);
+  out << inDim << " " << outDim << std::endl;
+  for(int d=0 ; d<inDim ; d++)
+    out << mean[d] << " ";
+  out << std::endl;
+  for(int d=0 ; d<inDim ; d++)
+    out << eigenvalues[d] << " ";
+  out << std::endl;
+  for(int d=0 ; d<inDim ; d++){
+    for(int r=0 ; r<outDim ; r++)
+      out << W[d*outDim + r] << " ";
+    out << std::endl;
+  }
+  out.close();
+}
+
+/**
+ * \fn void KMpca::project(const double* x, double* y)
+ * \brief Projects one descriptor: y = W'(x - mean).
+ *
+ * \param[in] x The descriptor (inDim values).
+ * \param[out] y The projected descriptor (outDim values).
+ */
+void KMpca::project(const double* x, double* y) const{
+  for(int r=0 ; r<outDim ; r++)
+    y[r] = 0;
+  for(int d=0 ; d<inDim ; d++){
+    double v = x[d] - mean[d];
+    const double* w = W + d*outDim;
+    for(int r=0 ; r<outDim ; r++)
+      y[r] += v*w[r];
+  }
+}
+
+/**
+ * \fn void KMpca::backProject(const double* y, double* x)
+ * \brief Reconstructs a descriptor from its projection: x = mean + Wy
+ * (the columns of W are orthonormal).
+ *
+ * \param[in] y The projected descriptor (outDim values).
+ * \param[out] x The descriptor (inDim values).
+ */
+void KMpca::backProject(const double* y, double* x) const{
+  for(int d=0 ; d<inDim ; d++){
+    const double* w = W + d*outDim;
+    double v = mean[d];
+    for(int r=0 ; r<outDim ; r++)
+      v += w[r]*y[r];
+    x[d] = v;
+  }
+}
+
+/**
+ * \fn void KMpca::project(const KMdata& in, KMdata& out)
+ * \brief Projects all the descriptors of in.
+ *
+ * \param[in] in The descriptors (of dimension inDim).
+ * \param[out] out The projected descriptors (allocated with outDim and at
+ * least as many points as in: its number of points is set).
+ */
+void KMpca::project(const KMdata& in, KMdata& out) const{
+  int n = in.getNPts();
+  out.setNPts(n);
+#pragma omp parallel for schedule(static) if(n > 1000)
+  for(int i=0 ; i<n ; i++)
+    project(in[i], out[i]);
+}
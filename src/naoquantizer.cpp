@@ -0,0 +1,622 @@
+/**
+ * \file naoquantizer.cpp
+ * \brief Nearest center search over a fixed codebook (training.means).
+ * \author agent
+ * \date 19/10/2026
+ *
+ */
+#include "naoquantizer.h"
+#include <fstream>
+#include <float.h>
+
+#define KM_QUANTIZER_LEAF_SIZE 4
+#define KM_PDE_STEP 8 // number of dimensions added between two tests
+
+/**
+ * \fn void kmNearestCentersKernel(const KMpointArray pts, int n, int dim, const T* ctrsT, const T* ctrNorms, int k, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Batched nearest center search computed as a matrix product:
+ * ||x-c||^2 = ||x||^2 - 2 X.C' + ||c||^2, with the argmin fused in the product.
+ *
+ * The descriptors are packed (and converted to T) by blocks of KM_BLOCK_PTS,
+ * each block is multiplied by the centers by blocks of KM_BLOCK_CTRS: the
+ * centers are transposed so that the innermost loop runs over consecutive
+ * centers (it is vectorized by the compiler without any reduction).
+ * ctrsT and ctrNorms are padded to kmPadCtrs(k) centers, the padding
+ * centers having a huge norm, so that the blocks have no scalar tail.
+ * The blocks of descriptors are shared between the threads.
+ * Ties are resolved to the smallest center index.
+ */
+template <typename T>
+static void kmNearestCentersKernel(const KMpointArray pts, int n, int dim,
+				   const T* ctrsT, const T* ctrNorms, int k,
+				   KMctrIdxArray closeCtr, double* sqDist){
+  int nrBlocks = (n + KM_BLOCK_PTS - 1)/KM_BLOCK_PTS;
+  int kPad = kmPadCtrs(k);
+#pragma omp parallel if(nrBlocks > 1)
+  {
+    T* xb = new T[KM_BLOCK_PTS*dim];
+    T xNorm[KM_BLOCK_PTS];
+    T best[KM_BLOCK_PTS];
+    int bestCtr[KM_BLOCK_PTS];
+    T acc0[KM_BLOCK_CTRS], acc1[KM_BLOCK_CTRS];
+#pragma omp for schedule(dynamic,1)
+    for(int b=0 ; b<nrBlocks ; b++){
+      int first = b*KM_BLOCK_PTS;
+      int bp = (first + KM_BLOCK_PTS <= n) ? KM_BLOCK_PTS : n - first;
+      // Packing the block
+      for(int i=0 ; i<bp ; i++){
+	const double* x = pts[first + i];
+	T* xi = xb + i*dim;
+	T norm = 0;
+	for(int d=0 ; d<dim ; d++){
+	  xi[d] = (T) x[d];
+	  norm += xi[d]*xi[d];
+	}
+	xNorm[i] = norm;
+	best[i] = 0;
+	bestCtr[i] = -1;
+      }
+      for(int cb=0 ; cb<kPad ; cb+=KM_BLOCK_CTRS){
+	int bc = (cb + KM_BLOCK_CTRS <= kPad) ? KM_BLOCK_CTRS : kPad - cb;
+	// Two descriptors at a time: each center value is loaded once for both
+	for(int i=0 ; i<bp ; i+=2){
+	  bool pair = (i+1 < bp);
+	  const T* x0 = xb + i*dim;
+	  const T* x1 = pair ? x0 + dim : x0;
+	  for(int j=0 ; j<bc ; j++){
+	    acc0[j] = 0;
+	    acc1[j] = 0;
+	  }
+	  const T* c = ctrsT + cb;
+	  for(int d=0 ; d<dim ; d++, c+=kPad){
+	    T v0 = x0[d], v1 = x1[d];
+	    for(int j=0 ; j<bc ; j++){
+	      acc0[j] += v0*c[j];
+	      acc1[j] += v1*c[j];
+	    }
+	  }
+	  // Fused argmin (||x||^2 is added at the end)
+	  for(int j=0 ; j<bc ; j++){
+	    T dist = ctrNorms[cb + j] - 2*acc0[j];
+	    if(bestCtr[i] < 0 || dist < best[i]){
+	      best[i] = dist;
+	      bestCtr[i] = cb + j;
+	    }
+	  }
+	  if(pair){
+	    for(int j=0 ; j<bc ; j++){
+	      T dist = ctrNorms[cb + j] - 2*acc1[j];
+	      if(bestCtr[i+1] < 0 || dist < best[i+1]){
+		best[i+1] = dist;
+		bestCtr[i+1] = cb + j;
+	      }
+	    }
+	  }
+	}
+      }
+      for(int i=0 ; i<bp ; i++){
+	closeCtr[first + i] = bestCtr[i];
+	if(sqDist){
+	  double dist = (double) best[i] + (double) xNorm[i];
+	  sqDist[first + i] = (dist < 0) ? 0 : dist; // rounding errors
+	}
+      }
+    }
+    delete[] xb;
+  }
+}
+
+/**
+ * \fn void kmNearestCentersPDEKernel(const KMpointArray pts, int n, int dim, const T* ctrs, int k, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Nearest center search with partial distance elimination: the
+ * squared distance to a center is given up as soon as it exceeds the best
+ * one (tested every KM_PDE_STEP dimensions). The first center tried is the
+ * one of the previous descriptor (consecutive descriptors of a video are
+ * often close), which makes the elimination effective early.
+ */
+template <typename T>
+static void kmNearestCentersPDEKernel(const KMpointArray pts, int n, int dim,
+				      const T* ctrs, int k,
+				      KMctrIdxArray closeCtr, double* sqDist){
+#pragma omp parallel if(n > KM_BLOCK_PTS)
+  {
+    T* x = new T[dim];
+    int guess = 0;
+#pragma omp for schedule(static)
+    for(int i=0 ; i<n ; i++){
+      for(int d=0 ; d<dim ; d++)
+	x[d] = (T) pts[i][d];
+      int bestCtr = guess;
+      T best = 0;
+      const T* c = ctrs + guess*dim;
+      for(int d=0 ; d<dim ; d++)
+	best += (x[d] - c[d])*(x[d] - c[d]);
+      for(int j=0 ; j<k ; j++){
+	if(j == guess) continue;
+	c = ctrs + j*dim;
+	T dist = 0;
+	int d = 0;
+	while(d < dim && dist <= best){
+	  int end = (d + KM_PDE_STEP < dim) ? d + KM_PDE_STEP : dim;
+	  for( ; d<end ; d++)
+	    dist += (x[d] - c[d])*(x[d] - c[d]);
+	}
+	if(dist < best || (dist == best && j < bestCtr)){
+	  best = dist;
+	  bestCtr = j;
+	}
+      }
+      closeCtr[i] = bestCtr;
+      if(sqDist) sqDist[i] = best;
+      guess = bestCtr;
+    }
+    delete[] x;
+  }
+}
+
+/**
+ * \fn void kmNearestCenters(const KMpointArray pts, int n, int dim, const double* ctrsT, const double* ctrNorms, int k, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Assigns n descriptors to their closest center (batched kernel).
+ *
+ * \param[in] pts The descriptors.
+ * \param[in] n The number of descriptors.
+ * \param[in] dim Their dimension.
+ * \param[in] ctrsT The k centers transposed and padded (ctrsT[d*kmPadCtrs(k) + c]).
+ * \param[in] ctrNorms The squared norms of the centers (KM_PAD_NORM for the padding).
+ * \param[in] k The number of centers.
+ * \param[out] closeCtr The closest center of each descriptor.
+ * \param[out] sqDist The squared distances (optional).
+ */
+void kmNearestCenters(const KMpointArray pts, int n, int dim,
+		      const double* ctrsT, const double* ctrNorms, int k,
+		      KMctrIdxArray closeCtr, double* sqDist){
+  kmNearestCentersKernel<double>(pts, n, dim, ctrsT, ctrNorms, k, closeCtr, sqDist);
+}
+
+/**
+ * \fn void kmNearestCenters(const KMpointArray pts, int n, int dim, const float* ctrsT, const float* ctrNorms, int k, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Single precision version: twice as many values per SIMD register,
+ * but descriptors which are almost equidistant to two centers may be
+ * assigned to the other one.
+ */
+void kmNearestCenters(const KMpointArray pts, int n, int dim,
+		      const float* ctrsT, const float* ctrNorms, int k,
+		      KMctrIdxArray closeCtr, double* sqDist){
+  kmNearestCentersKernel<float>(pts, n, dim, ctrsT, ctrNorms, k, closeCtr, sqDist);
+}
+
+/**
+ * \fn void kmNearestCentersPDE(const KMpointArray pts, int n, int dim, const double* ctrs, int k, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Assigns n descriptors to their closest center with partial
+ * distance elimination.
+ *
+ * \param[in] pts The descriptors.
+ * \param[in] n The number of descriptors.
+ * \param[in] dim Their dimension.
+ * \param[in] ctrs The k centers (row-major, ctrs[c*dim + d]).
+ * \param[in] k The number of centers.
+ * \param[out] closeCtr The closest center of each descriptor.
+ * \param[out] sqDist The squared distances (optional).
+ */
+void kmNearestCentersPDE(const KMpointArray pts, int n, int dim,
+			 const double* ctrs, int k,
+			 KMctrIdxArray closeCtr, double* sqDist){
+  kmNearestCentersPDEKernel<double>(pts, n, dim, ctrs, k, closeCtr, sqDist);
+}
+
+void kmNearestCentersPDE(const KMpointArray pts, int n, int dim,
+			 const float* ctrs, int k,
+			 KMctrIdxArray closeCtr, double* sqDist){
+  kmNearestCentersPDEKernel<float>(pts, n, dim, ctrs, k, closeCtr, sqDist);
+}
+
+/**
+ * \fn KMquantizer::KMquantizer(int dim, int k, const KMpointArray ctrs)
+ * \brief Builds the quantizer from centers in memory (they are copied).
+ *
+ * \param[in] dim The centers' dimension.
+ * \param[in] k The number of centers.
+ * \param[in] ctrs The centers.
+ */
+KMquantizer::KMquantizer(int dim, int k, const KMpointArray ctrs) :
+  dim(dim), k(k){
+  init(ctrs);
+}
+
+/**
+ * \fn KMquantizer::KMquantizer(std::string centers, int dim, int k)
+ * \brief Builds the quantizer from a file exported by exportCenters.
+ *
+ * \param[in] centers The file containing the centers (one center per line).
+ * \param[in] dim The centers' dimension.
+ * \param[in] k The number of centers.
+ */
+KMquantizer::KMquantizer(std::string centers, int dim, int k) :
+  dim(dim), k(k){
+  std::ifstream in(centers.c_str(), std::ios::in);
+  if(!in){
+    std::cerr << "Impossible to open the centers file " << centers << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  KMpointArray pts = kmAllocPts(k, dim);
+  for(int c=0 ; c<k ; c++){
+    for(int d=0 ; d<dim ; d++){
+      if(!(in >> pts[c][d])){
+	std::cerr << "The file " << centers << " does not contain "
+		  << k << " centers of dimension " << dim << std::endl;
+	exit(EXIT_FAILURE);
+      }
+    }
+  }
+  init(pts);
+  kmDeallocPts(pts);
+}
+
+KMquantizer::~KMquantizer(){
+  delete[] ctrs;
+  delete[] ctrNorms;
+  delete[] ctrsT;
+  delete[] ctrsF;
+  delete[] ctrNormsF;
+  delete[] ctrsTF;
+  delete[] ctrIdx;
+  delete[] cutDim;
+  delete[] cutVal;
+  delete[] loChild;
+  delete[] hiChild;
+}
+
+void KMquantizer::init(const KMpointArray pts){
+  ctrs = new double[k*dim];
+  int kPad = kmPadCtrs(k);
+  ctrNorms = new double[kPad];
+  for(int c=0 ; c<k ; c++){
+    double norm = 0;
+    for(int d=0 ; d<dim ; d++){
+      ctrs[c*dim + d] = pts[c][d];
+      norm += pts[c][d]*pts[c][d];
+    }
+    ctrNorms[c] = norm;
+  }
+  ctrsT = new double[dim*kPad];
+  for(int c=0 ; c<kPad ; c++){
+    if(c >= k) ctrNorms[c] = KM_PAD_NORM;
+    for(int d=0 ; d<dim ; d++)
+      ctrsT[d*kPad + c] = (c < k) ? ctrs[c*dim + d] : 0;
+  }
+  ctrsF = NULL; ctrNormsF = NULL; ctrsTF = NULL;
+  earlyExit = false;
+
+  root = -1;
+  nrNodes = 0;
+  ctrIdx = NULL; cutDim = NULL; cutVal = NULL; loChild = NULL; hiChild = NULL;
+  if(dim <= KM_QUANTIZER_TREE_MAX_DIM && k >= KM_QUANTIZER_TREE_MIN_K){
+    // A binary tree with leaves of at least 1 center has less than 2k nodes
+    ctrIdx = new int[k];
+    cutDim = new int[2*k];
+    cutVal = new double[2*k];
+    loChild = new int[2*k];
+    hiChild = new int[2*k];
+    for(int c=0 ; c<k ; c++)
+      ctrIdx[c] = c;
+    root = buildTree(0, k);
+  }
+}
+
+/**
+ * \fn void KMquantizer::setSinglePrecision(bool single)
+ * \brief Makes the scans (batched or with early exit) work in single
+ * precision. The kd-tree, if any, stays in double precision.
+ *
+ * \param[in] single True for float, false for double (default).
+ */
+void KMquantizer::setSinglePrecision(bool single){
+  if(!single){
+    delete[] ctrsF; delete[] ctrNormsF; delete[] ctrsTF;
+    ctrsF = NULL; ctrNormsF = NULL; ctrsTF = NULL;
+    return;
+  }
+  if(ctrsF) return;
+  int kPad = kmPadCtrs(k);
+  ctrsF = new float[k*dim];
+  ctrsTF = new float[dim*kPad];
+  ctrNormsF = new float[kPad];
+  for(int c=0 ; c<kPad ; c++){
+    float norm = 0;
+    for(int d=0 ; d<dim ; d++){
+      float v = (c < k) ? (float) ctrs[c*dim + d] : 0;
+      if(c < k) ctrsF[c*dim + d] = v;
+      ctrsTF[d*kPad + c] = v;
+      norm += v*v;
+    }
+    ctrNormsF[c] = (c < k) ? norm : (float) KM_PAD_NORM;
+  }
+}
+
+/**
+ * \fn int KMquantizer::buildTree(int first, int last)
+ * \brief Builds the kd-tree node of the centers ctrIdx[first..last[:
+ * they are split at the median of their dimension of largest spread.
+ *
+ * \return The index of the node.
+ */
+int KMquantizer::buildTree(int first, int last){
+  int node = nrNodes++;
+  if(last - first <= KM_QUANTIZER_LEAF_SIZE){
+    cutDim[node] = -1;
+    loChild[node] = first;
+    hiChild[node] = last;
+    return node;
+  }
+  int bestDim = 0;
+  double bestSpread = -1;
+  for(int d=0 ; d<dim ; d++){
+    double lo = DBL_MAX, hi = -DBL_MAX;
+    for(int i=first ; i<last ; i++){
+      double v = ctrs[ctrIdx[i]*dim + d];
+      if(v < lo) lo = v;
+      if(v > hi) hi = v;
+    }
+    if(hi - lo > bestSpread){
+      bestSpread = hi - lo;
+      bestDim = d;
+    }
+  }
+  // Partial selection sort around the median (k is small)
+  int mid = (first + last)/2;
+  for(int i=first ; i<=mid ; i++){
+    int m = i;
+    for(int j=i+1 ; j<last ; j++)
+      if(ctrs[ctrIdx[j]*dim + bestDim] < ctrs[ctrIdx[m]*dim + bestDim])
+	m = j;
+    int tmp = ctrIdx[i]; ctrIdx[i] = ctrIdx[m]; ctrIdx[m] = tmp;
+  }
+  cutDim[node] = bestDim;
+  cutVal[node] = ctrs[ctrIdx[mid]*dim + bestDim];
+  loChild[node] = buildTree(first, mid);
+  hiChild[node] = buildTree(mid, last);
+  return node;
+}
+
+void KMquantizer::searchTree(int node, const double* x,
+			     int& bestCtr, double& best) const{
+  if(cutDim[node] < 0){
+    for(int i=loChild[node] ; i<hiChild[node] ; i++){
+      const double* c = ctrs + ctrIdx[i]*dim;
+      double dist = 0;
+      for(int d=0 ; d<dim && dist<=best ; d++)
+	dist += (x[d] - c[d])*(x[d] - c[d]);
+      if(dist < best || (dist == best && ctrIdx[i] < bestCtr)){
+	best = dist;
+	bestCtr = ctrIdx[i];
+      }
+    }
+    return;
+  }
+  double diff = x[cutDim[node]] - cutVal[node];
+  int nearChild = (diff < 0) ? loChild[node] : hiChild[node];
+  int farChild = (diff < 0) ? hiChild[node] : loChild[node];
+  searchTree(nearChild, x, bestCtr, best);
+  if(diff*diff <= best)
+    searchTree(farChild, x, bestCtr, best);
+}
+
+int KMquantizer::nearestBruteForce(const double* x, double& best) const{
+  KMpoint pt = (KMpoint) x;
+  int bestCtr;
+  if(earlyExit){
+    if(ctrsF) kmNearestCentersPDE(&pt, 1, dim, ctrsF, k, &bestCtr, &best);
+    else kmNearestCentersPDE(&pt, 1, dim, ctrs, k, &bestCtr, &best);
+  }
+  else{
+    if(ctrsF) kmNearestCenters(&pt, 1, dim, ctrsTF, ctrNormsF, k, &bestCtr, &best);
+    else kmNearestCenters(&pt, 1, dim, ctrsT, ctrNorms, k, &bestCtr, &best);
+  }
+  return bestCtr;
+}
+
+/**
+ * \fn int KMquantizer::nearest(const double* x, double* sqDist)
+ * \brief Gives the closest center of one descriptor.
+ *
+ * \param[in] x The descriptor (dim values).
+ * \param[out] sqDist The squared distance to this center (optional).
+ * \return The index of the closest center.
+ */
+int KMquantizer::nearest(const double* x, double* sqDist) const{
+  int bestCtr = 0;
+  double best = DBL_MAX;
+  if(root >= 0)
+    searchTree(root, x, bestCtr, best);
+  else
+    bestCtr = nearestBruteForce(x, best);
+  if(sqDist) *sqDist = best;
+  return bestCtr;
+}
+
+/**
+ * \fn void KMquantizer::getAssignments(const KMdata& dataPts, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Assigns each descriptor of dataPts to its closest center
+ * (like KMfilterCenters::getAssignments, without any kc-tree).
+ *
+ * \param[in] dataPts The descriptors.
+ * \param[out] closeCtr The closest center of each descriptor.
+ * \param[out] sqDist The squared distances (optional).
+ */
+void KMquantizer::getAssignments(const KMdata& dataPts,
+				 KMctrIdxArray closeCtr,
+				 double* sqDist) const{
+  int nPts = dataPts.getNPts();
+  if(root >= 0){
+#pragma omp parallel for schedule(static) if(nPts > 1000)
+    for(int i=0 ; i<nPts ; i++)
+      closeCtr[i] = nearest(dataPts[i], sqDist ? sqDist + i : NULL);
+  }
+  else if(earlyExit){
+    if(ctrsF) kmNearestCentersPDE(dataPts.getPts(), nPts, dim, ctrsF, k, closeCtr, sqDist);
+    else kmNearestCentersPDE(dataPts.getPts(), nPts, dim, ctrs, k, closeCtr, sqDist);
+  }
+  else{
+    if(ctrsF) kmNearestCenters(dataPts.getPts(), nPts, dim, ctrsTF, ctrNormsF, k, closeCtr, sqDist);
+    else kmNearestCenters(dataPts.getPts(), nPts, dim, ctrsT, ctrNorms, k, closeCtr, sqDist);
+  }
+}
+
+/**
+ * \fn KMvocabularyTree::KMvocabularyTree(int dim, int b, int L)
+ * \brief Allocates a vocabulary tree (its centers are set by the training,
+ * see kmVocabularyTree).
+ *
+ * \param[in] dim The descriptors' dimension.
+ * \param[in] b The branching factor (>= 2).
+ * \param[in] L The depth (>= 1).
+ */
+KMvocabularyTree::KMvocabularyTree(int dim, int b, int L) :
+  dim(dim), b(b), L(L){
+  allocate();
+  for(int i=0 ; i<nrNodes*dim ; i++)
+    ctrs[i] = 0;
+  updateNorms();
+}
+
+/**
+ * \fn KMvocabularyTree::KMvocabularyTree(std::string file)
+ * \brief Imports a vocabulary tree saved by exportTree: the first line is
+ * "b L dim", then each line is the center of one node (from the node 1).
+ *
+ * \param[in] file The file containing the tree.
+ */
+KMvocabularyTree::KMvocabularyTree(std::string file){
+  std::ifstream in(file.c_str(), std::ios::in);
+  if(!in){
+    std::cerr << "Impossible to open the vocabulary tree " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if(!(in >> b >> L >> dim)){
+    std::cerr << "Bad header in the vocabulary tree " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  allocate();
+  for(int d=0 ; d<dim ; d++)
+    ctrs[d] = 0;
+  for(int i=dim ; i<nrNodes*dim ; i++){
+    if(!(in >> ctrs[i])){
+      std::cerr << "The vocabulary tree " << file << " is truncated" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  updateNorms();
+}
+
+KMvocabularyTree::~KMvocabularyTree(){
+  delete[] ctrs;
+  delete[] ctrNorms;
+}
+
+void KMvocabularyTree::allocate(){
+  if(b < 2 || L < 1 || dim < 1){
+    std::cerr << "Bad vocabulary tree: b=" << b << " L=" << L
+	      << " dim=" << dim << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  nrNodes = 1;
+  nrLeaves = 1;
+  for(int l=0 ; l<L ; l++){
+    nrLeaves *= b;
+    nrNodes += nrLeaves;
+  }
+  firstLeaf = nrNodes - nrLeaves;
+  ctrs = new double[nrNodes*dim];
+  ctrNorms = new double[nrNodes];
+}
+
+/**
+ * \fn void KMvocabularyTree::updateNorms()
+ * \brief Must be called once the centers have been changed.
+ */
+void KMvocabularyTree::updateNorms(){
+  for(int n=0 ; n<nrNodes ; n++){
+    const double* c = ctrs + n*dim;
+    double norm = 0;
+    for(int d=0 ; d<dim ; d++)
+      norm += c[d]*c[d];
+    ctrNorms[n] = norm;
+  }
+}
+
+/**
+ * \fn void KMvocabularyTree::exportTree(std::string file)
+ * \brief Exports the tree (see the constructor importing it).
+ *
+ * \param[in] file The file which will be containing the tree.
+ */
+void KMvocabularyTree::exportTree(std::string file) const{
+  std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc);
+  if(!out){
+    std::cerr << "Impossible to open the file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  out << b << " " << L << " " << dim << std::endl;
+  out.precision(17);
+  for(int n=1 ; n<nrNodes ; n++){
+    const double* c = ctrs + n*dim;
+    for(int d=0 ; d<dim ; d++)
+      out << c[d] << " ";
+    out << std::endl;
+  }
+  out.close();
+}
+
+/**
+ * \fn int KMvocabularyTree::leaf(const double* x, double* sqDist)
+ * \brief Goes down the tree to the closest child at each level.
+ *
+ * \param[in] x The descriptor (dim values).
+ * \param[out] sqDist The squared distance to the leaf's center (optional).
+ * \return The index of the leaf (the word) in [0, b^L[.
+ */
+int KMvocabularyTree::leaf(const double* x, double* sqDist) const{
+  double xNorm = 0;
+  for(int d=0 ; d<dim ; d++)
+    xNorm += x[d]*x[d];
+  int node = 0;
+  double best = 0;
+  for(int l=0 ; l<L ; l++){
+    int firstChild = node*b + 1;
+    int bestChild = firstChild;
+    for(int child=firstChild ; child<firstChild+b ; child++){
+      const double* c = ctrs + child*dim;
+      double dot = 0;
+      for(int d=0 ; d<dim ; d++)
+	dot += x[d]*c[d];
+      double dist = ctrNorms[child] - 2*dot;
+      if(child == firstChild || dist < best){
+	best = dist;
+	bestChild = child;
+      }
+    }
+    node = bestChild;
+  }
+  if(sqDist){
+    best += xNorm;
+    *sqDist = (best < 0) ? 0 : best; // rounding errors
+  }
+  return node - firstLeaf;
+}
+
+/**
+ * \fn void KMvocabularyTree::getAssignments(const KMdata& dataPts, KMctrIdxArray closeCtr, double* sqDist)
+ * \brief Assigns each descriptor of dataPts to its leaf.
+ *
+ * \param[in] dataPts The descriptors.
+ * \param[out] closeCtr The leaf of each descriptor.
+ * \param[out] sqDist The squared distances to the leaves' centers (optional).
+ */
+void KMvocabularyTree::getAssignments(const KMdata& dataPts,
+				      KMctrIdxArray closeCtr,
+				      double* sqDist) const{
+  int nPts = dataPts.getNPts();
+#pragma omp parallel for schedule(static) if(nPts > 1000)
+  for(int i=0 ; i<nPts ; i++)
+    closeCtr[i] = leaf(dataPts[i], sqDist ? sqDist + i : NULL);
+}
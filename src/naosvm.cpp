@@ -7,6 +7,10 @@
 */
 #include "naosvm.h" 
 #include <math.h>
+#include <string.h>
+#include <map>
+#include <algorithm>
+#include <omp.h>
 
 /**
  * \fn struct svm_problem importProblem(std::string file, int k)
@@ -20,11 +24,7 @@
 struct svm_problem importProblem(std::string file, int k){
   int l = nrOfLines(file);
   
-  std::cout << "Mallocing svmProblem..." << std::endl;
-  struct svm_problem svmProblem;
-  svmProblem.l = l;
-  svmProblem.y = (double*) malloc(svmProblem.l * sizeof(double));
-  svmProblem.x = (struct svm_node **) malloc(svmProblem.l * sizeof(struct svm_node *));
+  SvmProblemBuilder builder(l);
   
   float* bowTab = new float[k];
   int label;
@@ -44,7 +44,6 @@ struct svm_problem importProblem(std::string file, int k){
       bowTab[i] = .0;
     }
     lss >> label;
-    svmProblem.y[idActivity] = label;
     int center = 0;
     bool endOfLine = false;
     while(!endOfLine && center < k){
@@ -78,32 +77,12 @@ struct svm_problem importProblem(std::string file, int k){
       center++;
     }
     
-    int notZero = 0;
-    center = 0;
-    while(center < k){
-      if(bowTab[center] != 0){
-	notZero++;
-      }
-      center++;
-    }
-    int i = 0;
-    svmProblem.x[idActivity] = (svm_node *) malloc((notZero + 1) * sizeof(svm_node));
-    center = 0;
-    while(center < k){
-      if(bowTab[center] != .0){
-	svmProblem.x[idActivity][i].index = center + 1;
-	svmProblem.x[idActivity][i].value = bowTab[center];
-	i++;
-      }
-      center++;
-    }
-    svmProblem.x[idActivity][(notZero-1)+1].index = -1;
-    // c'est la fin du tableau pas besoin d'ajouer une valeur
+    builder.addBOW(bowTab, k, label);
     idActivity++;
   }
   in.close();
   delete[] bowTab;
-  return svmProblem;
+  return builder.build();
 }
 
 /**
@@ -184,61 +163,65 @@ void exportProblemZero(struct svm_problem svmProblem, std::string file, int k){
  * \return The svm problem in a structure.
  */
 struct svm_problem computeBOW(int label, const KMdata& dataPts, KMfilterCenters& ctrs){
-  int k = ctrs.getK();
-  int nPts = dataPts.getNPts();
-  
-  // 1. Getting assignments 
   KMctrIdxArray closeCtr = new KMctrIdx[dataPts.getNPts()]; // dataPts = 1 label
   double* sqDist = new double[dataPts.getNPts()];
   ctrs.getAssignments(closeCtr, sqDist); 
-  
-  // 2. Initializing histogram
+  struct svm_problem svmProblem = computeBOW(label, ctrs.getK(),
+					     dataPts.getNPts(), closeCtr);
+  delete[] closeCtr;
+  delete[] sqDist;
+  return svmProblem;
+}
+
+/**
+ * \fn struct svm_problem computeBOW(int label, const KMdata& dataPts, const KMcodebook& codebook)
+ * \brief Converts the KMdata into a Bag Of Words histogram with a codebook
+ * built once (no kc-tree is built over the video's descriptors). With a
+ * vocabulary tree the histogram is over the leaves of the tree.
+ *
+ * \param[in] label The label of the BOW.
+ * \param[in] dataPts The KMdata.
+ * \param[in] codebook The codebook (KMquantizer or KMvocabularyTree).
+ * \return The svm problem in a structure.
+ */
+struct svm_problem computeBOW(int label, const KMdata& dataPts,
+			      const KMcodebook& codebook){
+  KMctrIdxArray closeCtr = new KMctrIdx[dataPts.getNPts()];
+  codebook.getAssignments(dataPts, closeCtr);
+  struct svm_problem svmProblem = computeBOW(label, codebook.getK(),
+					     dataPts.getNPts(), closeCtr);
+  delete[] closeCtr;
+  return svmProblem;
+}
+
+/**
+ * \fn struct svm_problem computeBOW(int label, int k, int nPts, const KMctrIdxArray closeCtr)
+ * \brief Converts the assignments of nPts descriptors into a Bag Of Words.
+ *
+ * \param[in] label The label of the BOW.
+ * \param[in] k The number of centers.
+ * \param[in] nPts The number of descriptors.
+ * \param[in] closeCtr The closest center of each descriptor.
+ * \return The svm problem in a structure.
+ */
+struct svm_problem computeBOW(int label, int k, int nPts, const KMctrIdxArray closeCtr){
+  // 1. Initializing histogram
   float* bowHistogram = NULL;
   bowHistogram = new float[k];
   for(int centre = 0; centre<k; centre++)
     bowHistogram[centre]=0;
   
-  // 3. Filling histogram
+  // 2. Filling histogram
   for(int point = 0; point < nPts ; point++){
     bowHistogram[closeCtr[point]]++;
   }
-  delete[] closeCtr;
-  delete[] sqDist;
   
-  // 5. Exporting the BOW in the structure svmProblem
-  struct svm_problem svmProblem;
-  int l=1;
-  svmProblem.l = l;
-  svmProblem.y = (double*) malloc(svmProblem.l * sizeof(double));
-  svmProblem.x = (struct svm_node **) malloc(svmProblem.l * sizeof(struct svm_node *));
-  int idActivity = 0;
-  while(idActivity < l){
-    svmProblem.y[idActivity] = label;
-    int notZero = 0;
-    int center = 0;
-    while(center < k){
-      if(bowHistogram[center] != 0)
-    	notZero++;
-      center++;
-    }
-    int i = 0;
-    svmProblem.x[idActivity] = (svm_node *) malloc((notZero + 1) * sizeof(svm_node));
-    center = 0;
-    while(center < k){
-      if(bowHistogram[center] != .0){
-    	svmProblem.x[idActivity][i].index = center + 1;
-     	svmProblem.x[idActivity][i].value = bowHistogram[center];
-    	i++;
-      }
-      center++;
-    }
-    svmProblem.x[idActivity][(notZero-1)+1].index = -1;
-    // It is the end of the table we do not need to add a value
-    idActivity++;
-  }
+  // 3. Exporting the BOW in the structure svmProblem
+  SvmProblemBuilder builder(1);
+  builder.addBOW(bowHistogram, k, label);
   delete[] bowHistogram;
   
-  return svmProblem; 
+  return builder.build(); 
 }
 
 /**
@@ -444,6 +427,8 @@ struct svm_model* create_svm_model(int k, struct svm_problem svmProblem){
   svmParameter.shrinking = 1;	/* use the shrinking heuristics */
   svmParameter.probability = 0; /* do probability estimates */
   
+  svmParameter.parallel_fill = SVM_PARALLEL_FILL;
+  
   return svm_train(&svmProblem,&svmParameter);
 }
 void bow_gaussian_normalization(int k,
@@ -592,6 +577,14 @@ void MatrixC::addTransfer(double lab_in,double lab_out){
   if(lab_in == lab_out) this->nrRecognition++;
   this->nrTest++;
 }
+// adds the transfers of another matrix (of the same labels)
+void MatrixC::addMatrix(const MatrixC& mc){
+  for(int i=0; i<this->num_labels; i++)
+    for(int j=0; j<this->num_labels; j++)
+      this->m[i][j] += mc.m[i][j];
+  this->nrRecognition += mc.nrRecognition;
+  this->nrTest += mc.nrTest;
+}
 void MatrixC::calculFrequence(){
   int num = this->num_labels;
   for(int i=0; i<num; i++){
@@ -660,63 +653,128 @@ void bow_simple_normalization(struct svm_problem& svmProblem){
   }
 }
 
+/**
+ * \fn void destroy_svm_problem(struct svm_problem svmProblem)
+ * \brief Releases a problem allocated by alloc_svm_problem (or built by
+ * SvmProblemBuilder).
+ *
+ * \param[in] svmProblem The problem.
+ */
 void destroy_svm_problem(struct svm_problem svmProblem){
-  free(svmProblem.y);
-  //svmProblem.y = NULL;
-  
-  for(int a=0 ; a<svmProblem.l ; a++){
-    free(svmProblem.x[a]);
-    //svmProblem.x[a] = NULL;
-  }
-  free(svmProblem.x);
-  //svmProblem.x = NULL;
-}
-
-// Add only one BOW
-void addBOW(struct svm_node* bow, double label,
-	    struct svm_problem& svmProblem){
-  if(svmProblem.y==NULL || svmProblem.x==NULL){
-    cerr << "Huilong" << endl;
-    svmProblem.y=(double*)malloc(sizeof(double));
-    svmProblem.x=(struct svm_node**)malloc(sizeof(struct svm_node*));
-    if(svmProblem.y==NULL || svmProblem.x==NULL){
-      std::cerr << "Malloc error of svmProblem.x and svmProblem.y!" << std::endl;
-      exit(EXIT_FAILURE);
-    }
+  free(svmProblem.y); // the beginning of the block
+}
+
+/**
+ * \fn struct svm_problem alloc_svm_problem(int l, size_t nrNodes, struct svm_node** nodes)
+ * \brief Allocates a problem in one block: the l labels, the l pointers x
+ * and nrNodes nodes. The caller fills the nodes and makes x[i] point to
+ * the first node of each vector.
+ *
+ * \param[in] l The number of vectors.
+ * \param[in] nrNodes The number of nodes (with the -1 of each vector).
+ * \param[out] nodes The nodes of the block.
+ * \return The problem (to be released by destroy_svm_problem).
+ */
+struct svm_problem alloc_svm_problem(int l, size_t nrNodes, struct svm_node** nodes){
+  // The nodes are aligned on a double (32 bits pointers)
+  size_t offset = l*sizeof(double) + l*sizeof(struct svm_node*);
+  offset = (offset + sizeof(double) - 1)/sizeof(double)*sizeof(double);
+  size_t size = offset + nrNodes*sizeof(struct svm_node);
+  char* block = (char*) malloc(size > 0 ? size : 1);
+  if(block == NULL){
+    std::cerr << "Malloc error of svmProblem!" << std::endl;
+    exit(EXIT_FAILURE);
   }
-  else{
-    cerr << "Huilong" << endl;
-    double *tmpy=(double*)realloc(svmProblem.y,(svmProblem.l+1)*sizeof(double));
-    struct svm_node** tmpx=(struct svm_node**)realloc(svmProblem.x,(svmProblem.l+1)*sizeof(struct svm_node*));
-    if(tmpy==NULL || tmpx==NULL){
-      std::cerr << "Re-Malloc error of svmProblem.x and svmProblem.y!" << std::endl;
-      exit(EXIT_FAILURE);
-    }
-    svmProblem.y = tmpy;
-    svmProblem.x = tmpx;
-  }
-  cerr << "Fabien" << endl;
-  svmProblem.y[svmProblem.l] = label;
-  cerr << "YATTA" << endl;
-  int d=0;
-  cerr << "Jaqueline" << endl;
-  while(bow[d].index != -1){
-    if(d==0&&(svmProblem.x[svmProblem.l]=(struct svm_node*) malloc(2*sizeof(struct svm_node))) == NULL){
-      std::cerr << "Malloc error of svmProblem.x[svmProblem.l]!" << std::endl;
-      exit(EXIT_FAILURE);
-    }
-    else if((svmProblem.x[svmProblem.l] = 
-	     (struct svm_node*) realloc(svmProblem.x[svmProblem.l],
-					(d+2)*sizeof(struct svm_node))) == NULL){
-      std::cerr << "Re-Malloc error of svmProblem.x[svmProblem.l]!" << std::endl;
-      exit(EXIT_FAILURE);
-    }
-    svmProblem.x[svmProblem.l][d].index = bow[d].index;
-    svmProblem.x[svmProblem.l][d].value = bow[d].value;
+  struct svm_problem svmProblem;
+  svmProblem.l = l;
+  svmProblem.y = (double*) block;
+  svmProblem.x = (struct svm_node**) (block + l*sizeof(double));
+  *nodes = (struct svm_node*) (block + offset);
+  return svmProblem;
+}
+
+/**
+ * \fn SvmProblemBuilder::SvmProblemBuilder(int l, size_t nrNodes)
+ * \brief Creates an empty builder.
+ *
+ * \param[in] l,nrNodes The expected numbers of vectors and of nodes (with
+ * the -1 of each vector), reserved to avoid the reallocations.
+ */
+SvmProblemBuilder::SvmProblemBuilder(int l, size_t nrNodes){
+  y.reserve(l);
+  start.reserve(l);
+  nodes.reserve(nrNodes);
+}
+
+/**
+ * \fn void SvmProblemBuilder::addBOW(const struct svm_node* bow, double label)
+ * \brief Appends a BOW.
+ *
+ * \param[in] bow The BOW (ended by the index -1).
+ * \param[in] label Its label.
+ */
+void SvmProblemBuilder::addBOW(const struct svm_node* bow, double label){
+  y.push_back(label);
+  start.push_back(nodes.size());
+  int d = 0;
+  while(bow[d].index != -1)
     d++;
+  nodes.insert(nodes.end(), bow, bow + d + 1);
+}
+
+/**
+ * \fn void SvmProblemBuilder::addBOW(const float* histogram, int k, double label)
+ * \brief Appends a BOW given by its histogram (the empty bins are skipped).
+ *
+ * \param[in] histogram The k bins.
+ * \param[in] k The number of bins.
+ * \param[in] label The label of the BOW.
+ */
+void SvmProblemBuilder::addBOW(const float* histogram, int k, double label){
+  y.push_back(label);
+  start.push_back(nodes.size());
+  struct svm_node node;
+  for(int center=0 ; center<k ; center++){
+    if(histogram[center] != 0){
+      node.index = center + 1;
+      node.value = histogram[center];
+      nodes.push_back(node);
+    }
+  }
+  node.index = -1;
+  node.value = 0;
+  nodes.push_back(node);
+}
+
+/**
+ * \fn void SvmProblemBuilder::addProblem(const struct svm_problem& svmProblem)
+ * \brief Appends all the BOWs of a problem.
+ *
+ * \param[in] svmProblem The problem.
+ */
+void SvmProblemBuilder::addProblem(const struct svm_problem& svmProblem){
+  for(int i=0 ; i<svmProblem.l ; i++)
+    addBOW(svmProblem.x[i], svmProblem.y[i]);
+}
+
+/**
+ * \fn struct svm_problem SvmProblemBuilder::build()
+ * \brief Copies the BOWs appended into a problem in one block (see
+ * alloc_svm_problem). The builder can still be used.
+ *
+ * \return The problem (to be released by destroy_svm_problem).
+ */
+struct svm_problem SvmProblemBuilder::build() const{
+  int l = y.size();
+  struct svm_node* block = NULL;
+  struct svm_problem svmProblem = alloc_svm_problem(l, nodes.size(), &block);
+  if(nodes.size() > 0)
+    memcpy(block, &nodes[0], nodes.size()*sizeof(struct svm_node));
+  for(int i=0 ; i<l ; i++){
+    svmProblem.y[i] = y[i];
+    svmProblem.x[i] = block + start[i];
   }
-  svmProblem.x[svmProblem.l][d].index = -1;
-  svmProblem.l++;
+  return svmProblem;
 }
 
 void get_gaussian_parameters(int k,
@@ -812,8 +870,6 @@ int get_svm_problem_labels(const struct svm_problem& svmProblem, int** labels){
 }
 
 struct svm_problem equalizeSVMProblem(const struct svm_problem& svmProblem, struct svm_problem& svmRest){
-  int k = getMaxIndex(svmProblem);
-  
   int *labels = NULL;
   int nrLabels = get_svm_problem_labels(svmProblem,&labels);
   
@@ -822,61 +878,25 @@ struct svm_problem equalizeSVMProblem(const struct svm_problem& svmProblem, stru
   int min = getMinNumVideo(svmProblem);
   int nrVectors = nrLabels*min;
 
-  struct svm_problem equalizedProblem; 
-  equalizedProblem.l = nrVectors;
-  equalizedProblem.y =  new double[nrVectors];
-  equalizedProblem.x = new struct svm_node*[nrVectors];
-  for(int i=0 ; i<nrVectors ; i++){
-    equalizedProblem.x[i] = new struct svm_node[k+1];
-    // It is better to allocate following the number of index != 0 in svmProblem
-  }
-
-  svmRest.l = svmProblem.l - nrVectors;
-  svmRest.y = new double[svmRest.l];
-  svmRest.x = new struct svm_node*[svmRest.l];
-  for(int i=0 ; i<svmRest.l ; i++){
-    svmRest.x[i] = new struct svm_node[k+1];
-    // It is better to allocate following the number of index != 0 in svmProblem
-  }
-  
-  int indexEP=0; // Equalized problem
-  int indexRP=0; // Rest problem
+  SvmProblemBuilder equalized(nrVectors), rest(svmProblem.l - nrVectors);
   for(int i=0 ; i<nrLabels ; i++){
     int currentLabel = labels[i];
     int count=0;
-    int v=0;
-    while(v < svmProblem.l){
+    for(int v=0 ; v<svmProblem.l ; v++){
       if(svmProblem.y[v] == currentLabel){
 	if(count < min){
-	  int d=0;
-	  equalizedProblem.y[indexEP] = currentLabel;
-	  while(d < k && svmProblem.x[v][d].index != -1){
-	    equalizedProblem.x[indexEP][d].index = svmProblem.x[v][d].index;
-	    equalizedProblem.x[indexEP][d].value = svmProblem.x[v][d].value;
-	    d++;
-	  }
-	  equalizedProblem.x[indexEP][d].index = -1;
+	  equalized.addBOW(svmProblem.x[v], currentLabel);
 	  count++;
-	  indexEP++;
-	}
-	else{
-	  int d=0;
-	  svmRest.y[indexRP] = currentLabel;
-	  while(d < k && svmProblem.x[v][d].index != -1){
-	    svmRest.x[indexRP][d].index = svmProblem.x[v][d].index;
-	    svmRest.x[indexRP][d].value = svmProblem.x[v][d].value;
-	    d++;
-	  }
-	  svmRest.x[indexRP][d].index = -1;
-	  indexRP++;
 	}
+	else
+	  rest.addBOW(svmProblem.x[v], currentLabel);
       }
-      v++;
     }
   }
+  svmRest = rest.build();
   
   delete[] labels;
-  return equalizedProblem;
+  return equalized.build();
 }  
 int getMinNumVideo(const struct svm_problem& svmProblem){
   int* labels = NULL;
@@ -941,66 +961,93 @@ int svm_vote(int nr_class,
   }
   return indexMax;
 }
-// svm training funciton using the strategy one-vs-rest
-svm_model **svm_train_ovr(const svm_problem *prob, svm_parameter *param){
+/**
+ * \fn svm_model *svm_train_ovr_class(const svm_problem *prob, const svm_parameter *param, double label, double* alpha, double* G)
+ * \brief Trains the SVM of one class of the one-versus-the-rest strategy:
+ * the vectors of the other classes are labelled 0 and both sides are
+ * weighted by 1/sqrt(their number of vectors).
+ *
+ * The problem and the parameters are not modified (the class has its own
+ * labels and its own copy of the parameters), so several classes can be
+ * trained concurrently.
+ *
+ * \param[in] prob The problem (its vectors must live as long as the model).
+ * \param[in] param The parameters.
+ * \param[in] label The label of the class.
+ * \param[in,out] alpha,G The warm start of svm_train_warm (prob->l values
+ * each, G may be NULL), or NULL for a cold start. They receive the solution,
+ * which is the warm start of the next C of a path.
+ * \return The model.
+ */
+svm_model *svm_train_ovr_class(const svm_problem *prob, const svm_parameter *param,
+			       double label, double* alpha, double* G){
+  int l = prob->l;
+  svm_problem classProb = *prob;
+  classProb.y = new double[l];
+  double weight[2];
+  int weight_label[2];
+  svm_parameter classParam = *param;
+  classParam.nr_weight = 2;
+  classParam.weight = weight;
+  classParam.weight_label = weight_label;
+  weight_label[1] = ceil(label);
+  weight_label[0] = 0;
+  weight[0] = weight[1] = 0;
+  for(int j=0;j<l;j++){
+    if(label != prob->y[j]){
+      classProb.y[j] = 0;
+      weight[0] += 1;
+    }
+    else{
+      classProb.y[j] = prob->y[j];
+      weight[1] += 1;
+    }
+  }
+  weight[0] = 1/sqrt(weight[0]);
+  weight[1] = 1/sqrt(weight[1]);
+  svm_model *model = svm_train_warm(&classProb,&classParam,alpha,G);
+  // The model keeps a copy of the parameters: not of the weights
+  model->param.nr_weight = 0;
+  model->param.weight = NULL;
+  model->param.weight_label = NULL;
+  delete [] classProb.y;
+  return model;
+}
+
+/**
+ * \fn svm_model **svm_train_ovr(const svm_problem *prob, const svm_parameter *param)
+ * \brief Trains the SVMs of the one-versus-the-rest strategy (see
+ * svm_train_ovr_class). The nr_class models are trained concurrently.
+ *
+ * \param[in] prob The problem (its vectors must live as long as the models).
+ * \param[in] param The parameters.
+ * \return The nr_class models, in the order of get_labels_from_prob.
+ */
+svm_model **svm_train_ovr(const svm_problem *prob, const svm_parameter *param){
   int nr_class;
   vector<double> label;
   label = get_labels_from_prob(prob);
   nr_class = label.size();
-  int l = prob->l;
-  svm_model **model = new svm_model*[nr_class];
   if(nr_class == 1){
     std::cerr<<"Training data in only one class. Aborting!"<<std::endl;
     exit(EXIT_FAILURE);
   }
-  double *temp_y = new double[l];
-  param->weight = new double[2];
-  param->weight_label = new int[2];
-  for(int i=0;i<nr_class;i++){
-    double label_class = label[i];
-    for(int j=0;j<l;j++) temp_y[j] = prob->y[j];
-    param->nr_weight = 2;
-    param->weight_label[1] = ceil(label_class);
-    param->weight_label[0] = 0;
-    param->weight[0] = param->weight[1] = 0;
-    for(int j=0;j<l;j++){
-      if(label_class != prob->y[j]){
-        prob->y[j] = 0;
-        param->weight[0] += 1;
-      }
-      else{
-        param->weight[1] += 1;
-      }
-    }
-    param->weight[0] = 1/sqrt(param->weight[0]);
-    param->weight[1] = 1/sqrt(param->weight[1]);
-    model[i] = svm_train(prob,param);
-    for(int j=0;j<l;j++) prob->y[j] =  temp_y[j];
-  }
-  delete [] temp_y;
-  delete [] param->weight;
-  delete [] param->weight_label;
+  svm_model **model = new svm_model*[nr_class];
+#pragma omp parallel for schedule(dynamic,1)
+  for(int i=0;i<nr_class;i++)
+    model[i] = svm_train_ovr_class(prob,param,label[i]);
   return model;
 }
 
-// svm predictor using the one-vs-rest strategy returning the probilities
-double svm_predict_ovr_probs(svm_model** models, const svm_node* x,int nbr_class, double* probs, double lamda){
+// Probabilities exp(lamda*decv) normalized, and label of the highest decv
+static double svm_ovr_decision(const double* decvs, const double* labels,
+			       int nbr_class, double* probs, double lamda){
   if(lamda <= 0){
     std::cerr<<"ERROR: svm_predict_ovr_probs(): lamda must be positive!"<<std::endl;
     exit(EXIT_FAILURE);
   }
-  double *decvs = new double[nbr_class];
-  double *labels = new double[nbr_class];
   double totalExpDecv = 0;
   for(int i=0;i<nbr_class;i++){
-    labels[i] = models[i]->label[0]+models[i]->label[1];
-    double label_pred = svm_predict_values(models[i],x,&(decvs[i])); 
-
-    if(decvs[i]<0 && label_pred>0)
-      decvs[i] = -decvs[i];
-    if(decvs[i]>0 && label_pred<=0)
-      decvs[i] = -decvs[i];
-    
     probs[i] = exp(lamda*decvs[i]);
     totalExpDecv += probs[i];
   }
@@ -1015,11 +1062,842 @@ double svm_predict_ovr_probs(svm_model** models, const svm_node* x,int nbr_class
       label = labels[i];
     }
   }
+  return label;
+}
+
+// svm predictor using the one-vs-rest strategy returning the probilities
+double svm_predict_ovr_probs(svm_model** models, const svm_node* x,int nbr_class, double* probs, double lamda){
+  double *decvs = new double[nbr_class];
+  double *labels = new double[nbr_class];
+  for(int i=0;i<nbr_class;i++){
+    labels[i] = models[i]->label[0]+models[i]->label[1];
+    double label_pred = svm_predict_values(models[i],x,&(decvs[i])); 
+
+    if(decvs[i]<0 && label_pred>0)
+      decvs[i] = -decvs[i];
+    if(decvs[i]>0 && label_pred<=0)
+      decvs[i] = -decvs[i];
+  }
+  double label = svm_ovr_decision(decvs, labels, nbr_class, probs, lamda);
   delete [] decvs;
   delete [] labels;
   return label;
 }
 
+// Same kernel function (the parameters which are not used are not saved)
+static bool svm_same_kernel(const svm_parameter& p, const svm_parameter& q){
+  if(p.kernel_type != q.kernel_type)
+    return false;
+  switch(p.kernel_type){
+  case POLY:
+    return p.degree == q.degree && p.gamma == q.gamma && p.coef0 == q.coef0;
+  case RBF:
+    return p.gamma == q.gamma;
+  case SIGMOID:
+    return p.gamma == q.gamma && p.coef0 == q.coef0;
+  case RBFCHIS:
+    return p.A == q.A;
+  default:
+    return true;
+  }
+}
+
+// Lexicographic order of the sparse vectors (equal vectors are one SV)
+struct svm_node_less{
+  bool operator()(const svm_node* a, const svm_node* b) const{
+    if(a == b)
+      return false;
+    for( ; a->index != -1 && b->index != -1 ; ++a, ++b){
+      if(a->index != b->index)
+	return a->index < b->index;
+      if(a->value != b->value)
+	return a->value < b->value;
+    }
+    return a->index == -1 && b->index != -1;
+  }
+};
+
+/**
+ * \fn OvrPredictor::OvrPredictor(svm_model** models, int nr_class)
+ * \brief Compiles the one-versus-the-rest models (see svm_train_ovr): the
+ * SVs shared by several models (the same vector, or equal vectors for
+ * loaded models) are merged.
+ *
+ * \param[in] models The nr_class two-class models (same kernel).
+ * \param[in] nr_class The number of classes.
+ */
+OvrPredictor::OvrPredictor(svm_model** models, int nr_class) :
+  nr_class(nr_class){
+  const svm_parameter& param = models[0]->param;
+  std::map<const svm_node*, int, svm_node_less> index;
+  std::vector<const svm_node*> sv;
+  std::vector<int> svIndex; // the SVs of the models in the distinct SVs
+  for(int c=0 ; c<nr_class ; c++){
+    const svm_model* model = models[c];
+    if(model->nr_class != 2 || !svm_same_kernel(model->param, param)){
+      std::cerr << "The one-versus-the-rest models must be two-class models "
+		<< "with the same kernel!" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    for(int j=0 ; j<model->l ; j++){
+      std::map<const svm_node*, int, svm_node_less>::iterator it =
+	index.insert(std::make_pair((const svm_node*) model->SV[j], (int) sv.size())).first;
+      if(it->second == (int) sv.size())
+	sv.push_back(model->SV[j]);
+      svIndex.push_back(it->second);
+    }
+  }
+
+  int l = sv.size();
+  svs.param = param;
+  svs.param.nr_weight = 0;
+  svs.param.weight = NULL;
+  svs.param.weight_label = NULL;
+  svs.nr_class = 0;
+  svs.l = l;
+  svs.SV = (struct svm_node**) malloc((l > 0 ? l : 1)*sizeof(struct svm_node*));
+  for(int j=0 ; j<l ; j++)
+    svs.SV[j] = (struct svm_node*) sv[j];
+  svs.sv_coef = NULL;
+  svs.rho = NULL;
+  svs.probA = NULL;
+  svs.probB = NULL;
+  svs.sv_indices = NULL;
+  svs.label = NULL;
+  svs.nSV = NULL;
+  svs.free_sv = 0; // the models own the SVs
+  svm_build_dense_sv(&svs);
+
+  coef = new double[(size_t) nr_class*l];
+  rho = new double[nr_class];
+  labels = new double[nr_class];
+  for(size_t i=0 ; i<(size_t) nr_class*l ; i++)
+    coef[i] = 0;
+  int next = 0;
+  for(int c=0 ; c<nr_class ; c++){
+    const svm_model* model = models[c];
+    labels[c] = model->label[0] + model->label[1];
+    // As svm_predict_ovr_probs: decv > 0 when the class is predicted
+    double sign = (model->label[0] > 0) ? 1 : -1;
+    rho[c] = sign*model->rho[0];
+    double* row = coef + (size_t) c*l;
+    for(int j=0 ; j<model->l ; j++)
+      row[svIndex[next++]] += sign*model->sv_coef[0][j];
+  }
+
+  interDim = 0;
+  interStart = NULL;
+  interValues = interLow = interHigh = NULL;
+  if(param.kernel_type == INTERS)
+    buildIntersectionTables();
+
+  nrBuffers = omp_get_max_threads();
+  kvalueBuffers = new double[(size_t) nrBuffers*(l > 0 ? l : 1)];
+  rowBuffers = (svs.SV_dense != NULL) ? new float[(size_t) nrBuffers*svs.dense_dim] : NULL;
+  decvBuffers = new double[(size_t) nrBuffers*2*nr_class];
+}
+
+OvrPredictor::~OvrPredictor(){
+  svm_free_model_content(&svs);
+  delete[] coef;
+  delete[] rho;
+  delete[] labels;
+  delete[] interStart;
+  delete[] interValues;
+  delete[] interLow;
+  delete[] interHigh;
+  delete[] kvalueBuffers;
+  delete[] rowBuffers;
+  delete[] decvBuffers;
+}
+
+/**
+ * \fn void OvrPredictor::buildIntersectionTables()
+ * \brief Sorts the values of the SVs in each bin and computes the sums
+ * giving the decision values of the INTERS kernel (see the class). The
+ * position p of the bin d (0 <= p <= number of values) is
+ * interStart[d] + d + p: the tables hold nr_class sums per position.
+ */
+void OvrPredictor::buildIntersectionTables(){
+  int l = svs.l;
+  for(int j=0 ; j<l ; j++)
+    for(const svm_node* p=svs.SV[j] ; p->index != -1 ; ++p){
+      if(p->value < 0 || p->index < 1){
+	interDim = 0; // min(x, sv) is not piecewise linear around 0
+	return;
+      }
+      if(p->index > interDim)
+	interDim = p->index;
+    }
+  interStart = new int[interDim + 1];
+  for(int d=0 ; d<=interDim ; d++)
+    interStart[d] = 0;
+  for(int j=0 ; j<l ; j++)
+    for(const svm_node* p=svs.SV[j] ; p->index != -1 ; ++p)
+      interStart[p->index]++;
+  for(int d=0 ; d<interDim ; d++)
+    interStart[d + 1] += interStart[d];
+  int nnz = interStart[interDim];
+  std::vector<std::pair<double, int> > entries(nnz); // (value, SV)
+  std::vector<int> fill(interStart, interStart + interDim);
+  for(int j=0 ; j<l ; j++)
+    for(const svm_node* p=svs.SV[j] ; p->index != -1 ; ++p)
+      entries[fill[p->index - 1]++] = std::make_pair(p->value, j);
+
+  interValues = new double[nnz > 0 ? nnz : 1];
+  interLow = new double[(size_t) (nnz + interDim)*nr_class];
+  interHigh = new double[(size_t) (nnz + interDim)*nr_class];
+  for(int d=0 ; d<interDim ; d++){
+    int first = interStart[d], m = interStart[d + 1] - first;
+    std::sort(entries.begin() + first, entries.begin() + first + m);
+    for(int i=0 ; i<m ; i++)
+      interValues[first + i] = entries[first + i].first;
+    double* low = interLow + (size_t) (first + d)*nr_class;
+    double* high = interHigh + (size_t) (first + d)*nr_class;
+    for(int c=0 ; c<nr_class ; c++){
+      const double* row = coef + (size_t) c*l;
+      double sum = 0;
+      low[c] = 0;
+      for(int i=0 ; i<m ; i++){
+	sum += row[entries[first + i].second]*entries[first + i].first;
+	low[(i + 1)*nr_class + c] = sum;
+      }
+      sum = 0;
+      high[m*nr_class + c] = 0;
+      for(int i=m-1 ; i>=0 ; i--){
+	sum += row[entries[first + i].second];
+	high[i*nr_class + c] = sum;
+      }
+    }
+  }
+}
+
+/**
+ * \fn void OvrPredictor::decisionValues(const svm_node* x, double* decvs)
+ * \brief Gives the decision values of x for all the classes (positive
+ * when x is recognized as the class).
+ *
+ * \param[in] x The BOW.
+ * \param[out] decvs The nr_class decision values.
+ */
+void OvrPredictor::decisionValues(const svm_node* x, double* decvs){
+  decisionValues(x, decvs, kvalueBuffers, rowBuffers); // the first buffers
+}
+
+// The same in the buffers kvalue (svs.l values) and row (svs.dense_dim
+// floats, or NULL to allocate it)
+void OvrPredictor::decisionValues(const svm_node* x, double* decvs,
+				  double* kvalue, float* row) const{
+  if(interStart != NULL){
+    bool nonNegative = true;
+    for(const svm_node* p=x ; p->index != -1 && nonNegative ; ++p)
+      nonNegative = (p->value >= 0);
+    if(nonNegative){
+      for(int c=0 ; c<nr_class ; c++)
+	decvs[c] = -rho[c];
+      for( ; x->index != -1 ; ++x){
+	// No SV has this bin (or x_d = 0): min(x_d, 0) = 0
+	if(x->index < 1 || x->index > interDim || x->value == 0)
+	  continue;
+	int d = x->index - 1;
+	double s = x->value;
+	const double* values = interValues + interStart[d];
+	int m = interStart[d + 1] - interStart[d];
+	size_t pos = (size_t) (interStart[d] + d + (std::upper_bound(values, values + m, s) - values))*nr_class;
+	for(int c=0 ; c<nr_class ; c++)
+	  decvs[c] += interLow[pos + c] + s*interHigh[pos + c];
+      }
+      return;
+    }
+  }
+  int l = svs.l;
+  svm_kernel_values(&svs, x, kvalue, row);
+  for(int c=0 ; c<nr_class ; c++){
+    const double* coef_c = coef + (size_t) c*l;
+    double sum = 0;
+    for(int j=0 ; j<l ; j++)
+      sum += coef_c[j]*kvalue[j];
+    decvs[c] = sum - rho[c];
+  }
+}
+
+/**
+ * \fn double OvrPredictor::predict(const svm_node* x, double* probs, double lamda)
+ * \brief Predicts the label of x as svm_predict_ovr_probs.
+ *
+ * \param[in] x The BOW.
+ * \param[out] probs The probabilities of the nr_class classes.
+ * \param[in] lamda The factor of the decision values in the probabilities.
+ * \return The label of the highest decision value.
+ */
+double OvrPredictor::predict(const svm_node* x, double* probs, double lamda){
+  double label;
+  predictBatch(&x, 1, &label, probs, lamda);
+  return label;
+}
+
+/**
+ * \fn void OvrPredictor::predictBatch(const svm_node* const* x, int n, double* predicted, double* probs, double lamda)
+ * \brief Predicts n BOWs as predict, concurrently and without allocation
+ * (see the class).
+ *
+ * \param[in] x The n BOWs.
+ * \param[in] n The number of BOWs.
+ * \param[out] predicted The n labels (or NULL).
+ * \param[out] probs The n x nr_class probabilities (or NULL).
+ * \param[in] lamda The factor of the decision values in the probabilities.
+ */
+void OvrPredictor::predictBatch(const svm_node* const* x, int n, double* predicted,
+				double* probs, double lamda){
+  int l = (svs.l > 0) ? svs.l : 1;
+#pragma omp parallel num_threads(nrBuffers) if(n > 1)
+  {
+    int t = omp_get_thread_num();
+    double* kvalue = kvalueBuffers + (size_t) t*l;
+    float* row = rowBuffers ? rowBuffers + (size_t) t*svs.dense_dim : NULL;
+    double* decvs = decvBuffers + (size_t) t*2*nr_class;
+    double* p = decvs + nr_class;
+#pragma omp for schedule(static)
+    for(int i=0 ; i<n ; i++){
+      decisionValues(x[i], decvs, kvalue, row);
+      double label = svm_ovr_decision(decvs, labels, nr_class,
+				      probs ? probs + (size_t) i*nr_class : p, lamda);
+      if(predicted)
+	predicted[i] = label;
+    }
+  }
+}
+
+double svm_predict_ovr_probs(OvrPredictor& predictor, const svm_node* x,
+			     double* probs, double lamda){
+  return predictor.predict(x, probs, lamda);
+}
+
+void svm_predict_ovr_batch(OvrPredictor& predictor, const svm_node* const* x,
+			   int n, double* predicted, double* probs, double lamda){
+  predictor.predictBatch(x, n, predicted, probs, lamda);
+}
+
+/**
+ * \fn AdditiveKernelMap::AdditiveKernelMap(int kernel_type, int k, int order)
+ * \brief Samples kappa for the feature map of a kernel.
+ *
+ * \param[in] kernel_type CHIS or INTERS.
+ * \param[in] k The dimension of the BOWs.
+ * \param[in] order The number of samples of kappa (besides kappa(0)).
+ */
+AdditiveKernelMap::AdditiveKernelMap(int kernel_type, int k, int order) :
+  kernel_type(kernel_type), k(k), order(order){
+  if(kernel_type != CHIS && kernel_type != INTERS){
+    std::cerr << "Only the CHIS and INTERS kernels have a feature map!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if(order < 0 || k < 1){
+    std::cerr << "Bad feature map: order " << order << ", k " << k << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  int features = k*(2*order + 1);
+  dim = (features + SVM_MAP_WIDTH - 1)/SVM_MAP_WIDTH*SVM_MAP_WIDTH;
+  // The periods of VLFeat (vl_homkermap)
+  if(kernel_type == CHIS)
+    period = 2*M_PI/(5.86*sqrt((double) order) + 3.65);
+  else
+    period = 2*M_PI/(2.38*log(order + 0.8) + 5.6);
+  kappa = new double[order + 1];
+  for(int j=0 ; j<=order ; j++){
+    double l = j*period;
+    double kappaL = (kernel_type == CHIS) ? 0.5/cosh(M_PI*l) : 2/(M_PI*(1 + 4*l*l));
+    kappa[j] = ((j > 0) ? 2 : 1)*period*kappaL;
+  }
+}
+
+AdditiveKernelMap::~AdditiveKernelMap(){
+  delete[] kappa;
+}
+
+/**
+ * \fn void AdditiveKernelMap::map(const svm_node* x, float* psi)
+ * \brief Computes the feature map of a BOW: for a bin of value v > 0,
+ * sqrt(v.L.kappa(0)) then sqrt(2.v.L.kappa(jL)).(cos, sin)(jL.log(v)).
+ *
+ * \param[in] x The BOW (the bins beyond k are ignored).
+ * \param[out] psi The dim features.
+ */
+void AdditiveKernelMap::map(const svm_node* x, float* psi) const{
+  for(int d=0 ; d<dim ; d++)
+    psi[d] = 0;
+  int block = 2*order + 1;
+  for( ; x->index != -1 ; ++x){
+    double v = x->value;
+    if(x->index < 1 || x->index > k || v <= 0)
+      continue;
+    float* p = psi + (x->index - 1)*block;
+    double logv = log(v);
+    p[0] = (float) sqrt(v*kappa[0]);
+    for(int j=1 ; j<=order ; j++){
+      double r = sqrt(v*kappa[j]);
+      p[2*j - 1] = (float) (r*cos(j*period*logv));
+      p[2*j] = (float) (r*sin(j*period*logv));
+    }
+  }
+}
+
+/**
+ * \fn void AdditiveKernelMap::map(const svm_node* const* x, int n, float* psi)
+ * \brief Computes the feature map of n BOWs concurrently.
+ *
+ * \param[out] psi The n x dim features.
+ */
+void AdditiveKernelMap::map(const svm_node* const* x, int n, float* psi) const{
+#pragma omp parallel for schedule(static)
+  for(int i=0 ; i<n ; i++)
+    map(x[i], psi + (size_t) i*dim);
+}
+
+/**
+ * \fn LinearOvrPredictor::LinearOvrPredictor(svm_model** models, int nr_class, int k, int order)
+ * \brief Turns the CHIS or INTERS one-versus-the-rest models (see
+ * svm_train_ovr) into linear models over the feature map.
+ *
+ * \param[in] models The nr_class two-class models (same kernel).
+ * \param[in] nr_class The number of classes.
+ * \param[in] k The dimension of the BOWs.
+ * \param[in] order The number of samples of kappa (besides kappa(0)).
+ */
+LinearOvrPredictor::LinearOvrPredictor(svm_model** models, int nr_class, int k, int order) :
+  nr_class(nr_class){
+  init(models[0]->param.kernel_type, k, order);
+  double* wc = new double[dim];
+  float* psi = new float[dim];
+  for(int c=0 ; c<nr_class ; c++){
+    const svm_model* model = models[c];
+    if(model->nr_class != 2 || model->param.kernel_type != kernelMap->getKernelType()){
+      std::cerr << "Only two-class models with the same kernel can be turned into linear models!"
+		<< std::endl;
+      exit(EXIT_FAILURE);
+    }
+    labels[c] = model->label[0] + model->label[1];
+    // As svm_predict_ovr_probs: decv > 0 when the class is predicted
+    double sign = (model->label[0] > 0) ? 1 : -1;
+    rho[c] = sign*model->rho[0];
+    for(int d=0 ; d<dim ; d++)
+      wc[d] = 0;
+    for(int j=0 ; j<model->l ; j++){
+      kernelMap->map(model->SV[j], psi);
+      double coef = sign*model->sv_coef[0][j];
+      for(int d=0 ; d<dim ; d++)
+	wc[d] += coef*psi[d];
+    }
+    for(int d=0 ; d<dim ; d++)
+      w[(size_t) c*dim + d] = (float) wc[d];
+  }
+  delete[] wc;
+  delete[] psi;
+}
+
+/**
+ * \fn LinearOvrPredictor::LinearOvrPredictor(int kernel_type, int k, int order, const std::vector<double>& labels)
+ * \brief Null models of the classes labels, to be trained (see train).
+ */
+LinearOvrPredictor::LinearOvrPredictor(int kernel_type, int k, int order,
+				       const std::vector<double>& labels) :
+  nr_class(labels.size()){
+  init(kernel_type, k, order);
+  for(int c=0 ; c<nr_class ; c++){
+    this->labels[c] = labels[c];
+    rho[c] = 0;
+  }
+}
+
+/**
+ * \fn LinearOvrPredictor::LinearOvrPredictor(std::string file)
+ * \brief Imports the linear models saved by exportModels: the first line
+ * is "kernel nr_class k order" (kernel is chis or inters), then the
+ * labels, rho and the nr_class weight vectors.
+ *
+ * \param[in] file The file containing the linear models.
+ */
+LinearOvrPredictor::LinearOvrPredictor(std::string file){
+  std::ifstream in(file.c_str(), std::ios::in);
+  if(!in){
+    std::cerr << "Impossible to open the linear models file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::string kernel;
+  int k, order;
+  if(!(in >> kernel >> nr_class >> k >> order) || nr_class < 1 ||
+     (kernel.compare("chis") != 0 && kernel.compare("inters") != 0)){
+    std::cerr << "Bad header in the linear models file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  init(kernel.compare("chis") == 0 ? CHIS : INTERS, k, order);
+  bool ok = true;
+  for(int c=0 ; c<nr_class && ok ; c++)
+    ok = !(in >> labels[c]).fail();
+  for(int c=0 ; c<nr_class && ok ; c++)
+    ok = !(in >> rho[c]).fail();
+  int features = k*(2*order + 1);
+  for(int c=0 ; c<nr_class && ok ; c++)
+    for(int d=0 ; d<features && ok ; d++)
+      ok = !(in >> w[(size_t) c*dim + d]).fail();
+  if(!ok){
+    std::cerr << "The linear models file " << file << " is truncated" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Allocates the feature map and the models (null weights)
+void LinearOvrPredictor::init(int kernel_type, int k, int order){
+  kernelMap = new AdditiveKernelMap(kernel_type, k, order);
+  dim = kernelMap->getDim();
+  w = new float[(size_t) nr_class*dim];
+  for(size_t i=0 ; i<(size_t) nr_class*dim ; i++)
+    w[i] = 0;
+  rho = new double[nr_class];
+  labels = new double[nr_class];
+  nrBuffers = omp_get_max_threads();
+  psiBuffers = new float[(size_t) nrBuffers*dim];
+  decvBuffers = new double[(size_t) nrBuffers*2*nr_class];
+}
+
+LinearOvrPredictor::~LinearOvrPredictor(){
+  delete kernelMap;
+  delete[] w;
+  delete[] rho;
+  delete[] labels;
+  delete[] psiBuffers;
+  delete[] decvBuffers;
+}
+
+/**
+ * \fn void LinearOvrPredictor::exportModels(std::string file)
+ * \brief Exports the linear models (see the constructor importing them).
+ *
+ * \param[in] file The file which will be containing the linear models.
+ */
+void LinearOvrPredictor::exportModels(std::string file) const{
+  std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc);
+  if(!out){
+    std::cerr << "Impossible to open the file " << file << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  int k = kernelMap->getK(), order = kernelMap->getOrder();
+  out.precision(9);
+  out << (kernelMap->getKernelType() == CHIS ? "chis" : "inters") << " "
+      << nr_class << " " << k << " " << order << std::endl;
+  for(int c=0 ; c<nr_class ; c++)
+    out << labels[c] << " ";
+  out << std::endl;
+  out.precision(17);
+  for(int c=0 ; c<nr_class ; c++)
+    out << rho[c] << " ";
+  out << std::endl;
+  out.precision(9);
+  int features = k*(2*order + 1);
+  for(int c=0 ; c<nr_class ; c++){
+    for(int d=0 ; d<features ; d++)
+      out << w[(size_t) c*dim + d] << " ";
+    out << std::endl;
+  }
+  out.close();
+}
+
+// Dot product of dim floats (dim multiple of SVM_MAP_WIDTH): partial sums
+// over the SIMD width, so that the loop is vectorized
+static double svm_map_dot(const float* x, const float* y, int dim){
+  float acc[SVM_MAP_WIDTH] = {0};
+  for(int d=0 ; d<dim ; d+=SVM_MAP_WIDTH)
+    for(int j=0 ; j<SVM_MAP_WIDTH ; j++)
+      acc[j] += x[d + j]*y[d + j];
+  double sum = 0;
+  for(int j=0 ; j<SVM_MAP_WIDTH ; j++)
+    sum += acc[j];
+  return sum;
+}
+
+/**
+ * \fn static void svm_dual_cd(const float* psi, int dim, const std::vector<int>& rows, const double* y, double label, double C, double* alpha, float* w, double& rho)
+ * \brief Trains one linear SVM of the one-versus-the-rest strategy (the
+ * class label against the others, weighted as in svm_train_ovr) by dual
+ * coordinate descent (Hsieh et al., the L1-loss dual solver of
+ * LIBLINEAR, with a bias feature of 1 and without shrinking): every pass
+ * minimizes the dual along each alpha_i in a random order.
+ *
+ * \param[in] psi The mapped BOWs (dim floats each).
+ * \param[in] rows The training BOWs in psi.
+ * \param[in] y The labels of the BOWs of psi.
+ * \param[in,out] alpha The dual variables of the rows: the starting point
+ * (clipped to the box of C, 0 for a cold start) and the solution.
+ * \param[out] w The weight vector (dim floats), rho the threshold.
+ */
+static void svm_dual_cd(const float* psi, int dim, const std::vector<int>& rows,
+			const double* y, double label, double C,
+			double* alpha, float* w, double& rho){
+  int l = rows.size();
+  int nrPositive = 0;
+  for(int i=0 ; i<l ; i++)
+    if(y[rows[i]] == label)
+      nrPositive++;
+  double upperPositive = (nrPositive > 0) ? C/sqrt((double) nrPositive) : 0;
+  double upperNegative = (nrPositive < l) ? C/sqrt((double) (l - nrPositive)) : 0;
+  
+  std::vector<double> wd(dim, 0), upper(l), QD(l);
+  std::vector<signed char> s(l);
+  double bias = 0;
+  for(int i=0 ; i<l ; i++){
+    const float* x = psi + (size_t) rows[i]*dim;
+    s[i] = (y[rows[i]] == label) ? 1 : -1;
+    upper[i] = (s[i] > 0) ? upperPositive : upperNegative;
+    alpha[i] = (alpha[i] < 0) ? 0 : (alpha[i] > upper[i] ? upper[i] : alpha[i]);
+    QD[i] = svm_map_dot(x, x, dim) + 1;
+    if(alpha[i] > 0){
+      double d = s[i]*alpha[i];
+      for(int j=0 ; j<dim ; j++)
+	wd[j] += d*x[j];
+      bias += d;
+    }
+  }
+  for(int j=0 ; j<dim ; j++)
+    w[j] = (float) wd[j];
+  
+  std::vector<int> order(l);
+  for(int i=0 ; i<l ; i++)
+    order[i] = i;
+  unsigned int seed = 1 + (unsigned int) label;
+  for(int iter=0 ; iter<SVM_DCD_MAX_ITER ; iter++){
+    for(int i=0 ; i<l-1 ; i++){
+      seed = seed*1103515245 + 12345;
+      int j = i + (seed >> 8)%(l - i);
+      std::swap(order[i], order[j]);
+    }
+    double PGmax = -HUGE_VAL, PGmin = HUGE_VAL;
+    for(int n=0 ; n<l ; n++){
+      int i = order[n];
+      const float* x = psi + (size_t) rows[i]*dim;
+      double G = s[i]*(svm_map_dot(w, x, dim) + bias) - 1;
+      double PG = 0;
+      if(alpha[i] == 0){
+	if(G < 0) PG = G;
+      }
+      else if(alpha[i] == upper[i]){
+	if(G > 0) PG = G;
+      }
+      else
+	PG = G;
+      if(PG > PGmax) PGmax = PG;
+      if(PG < PGmin) PGmin = PG;
+      if(fabs(PG) > 1e-12){
+	double old = alpha[i];
+	alpha[i] = old - G/QD[i];
+	alpha[i] = (alpha[i] < 0) ? 0 : (alpha[i] > upper[i] ? upper[i] : alpha[i]);
+	double d = (alpha[i] - old)*s[i];
+	for(int j=0 ; j<dim ; j++){
+	  wd[j] += d*x[j];
+	  w[j] = (float) wd[j];
+	}
+	bias += d;
+      }
+    }
+    if(PGmax - PGmin <= SVM_DCD_EPS)
+      break;
+  }
+  rho = -bias;
+}
+
+/**
+ * \fn void LinearOvrPredictor::train(const float* psi, const std::vector<int>& rows, const double* y, const struct svm_parameter& param, double* alpha)
+ * \brief Trains the linear models on mapped BOWs by dual coordinate
+ * descent with the C of param. The classes are trained concurrently.
+ *
+ * Warm start: alpha is the starting point (0 for a cold start) and
+ * receives the solution, so that the models of a C path (increasing C)
+ * are each trained from the solution of the previous C.
+ *
+ * \param[in] psi The BOWs mapped with getMap() (dim floats each).
+ * \param[in] rows The training BOWs in psi.
+ * \param[in] y The labels of the BOWs of psi.
+ * \param[in] param The parameters (C).
+ * \param[in,out] alpha The rows.size() x nr_class dual variables.
+ */
+void LinearOvrPredictor::train(const float* psi, const std::vector<int>& rows,
+			       const double* y, const struct svm_parameter& param,
+			       double* alpha){
+  int l = rows.size();
+#pragma omp parallel for schedule(dynamic,1)
+  for(int c=0 ; c<nr_class ; c++)
+    svm_dual_cd(psi, dim, rows, y, labels[c], param.C,
+		alpha + (size_t) c*l, w + (size_t) c*dim, rho[c]);
+}
+
+/**
+ * \fn void LinearOvrPredictor::decisionValues(const float* psi, double* decvs)
+ * \brief Gives the decision values of a mapped BOW for all the classes.
+ *
+ * \param[in] psi The mapped BOW (dim floats).
+ * \param[out] decvs The nr_class decision values.
+ */
+void LinearOvrPredictor::decisionValues(const float* psi, double* decvs) const{
+  for(int c=0 ; c<nr_class ; c++)
+    decvs[c] = svm_map_dot(w + (size_t) c*dim, psi, dim) - rho[c];
+}
+
+void LinearOvrPredictor::decisionValues(const svm_node* x, double* decvs){
+  kernelMap->map(x, psiBuffers); // the first buffer
+  decisionValues(psiBuffers, decvs);
+}
+
+/**
+ * \fn double LinearOvrPredictor::predict(const float* psi, double* probs, double lamda)
+ * \brief Predicts the label of a mapped BOW as svm_predict_ovr_probs.
+ */
+double LinearOvrPredictor::predict(const float* psi, double* probs, double lamda){
+  double label;
+  predictBatch(psi, 1, &label, probs, lamda);
+  return label;
+}
+
+double LinearOvrPredictor::predict(const svm_node* x, double* probs, double lamda){
+  double label;
+  predictBatch(&x, 1, &label, probs, lamda);
+  return label;
+}
+
+/**
+ * \fn void LinearOvrPredictor::predictBatch(const float* psi, int n, double* predicted, double* probs, double lamda)
+ * \brief Predicts n mapped BOWs as predict, concurrently and without
+ * allocation.
+ *
+ * \param[in] psi The n x dim mapped BOWs.
+ * \param[in] n The number of BOWs.
+ * \param[out] predicted The n labels (or NULL).
+ * \param[out] probs The n x nr_class probabilities (or NULL).
+ * \param[in] lamda The factor of the decision values in the probabilities.
+ */
+void LinearOvrPredictor::predictBatch(const float* psi, int n, double* predicted,
+				      double* probs, double lamda){
+#pragma omp parallel num_threads(nrBuffers) if(n > 1)
+  {
+    double* decvs = decvBuffers + (size_t) omp_get_thread_num()*2*nr_class;
+    double* p = decvs + nr_class;
+#pragma omp for schedule(static)
+    for(int i=0 ; i<n ; i++){
+      decisionValues(psi + (size_t) i*dim, decvs);
+      double label = svm_ovr_decision(decvs, labels, nr_class,
+				      probs ? probs + (size_t) i*nr_class : p, lamda);
+      if(predicted)
+	predicted[i] = label;
+    }
+  }
+}
+
+/**
+ * \fn void LinearOvrPredictor::predictBatch(const svm_node* const* x, int n, double* predicted, double* probs, double lamda)
+ * \brief The same for n BOWs, each one mapped in a buffer of its thread.
+ */
+void LinearOvrPredictor::predictBatch(const svm_node* const* x, int n, double* predicted,
+				      double* probs, double lamda){
+#pragma omp parallel num_threads(nrBuffers) if(n > 1)
+  {
+    int t = omp_get_thread_num();
+    float* psi = psiBuffers + (size_t) t*dim;
+    double* decvs = decvBuffers + (size_t) t*2*nr_class;
+    double* p = decvs + nr_class;
+#pragma omp for schedule(static)
+    for(int i=0 ; i<n ; i++){
+      kernelMap->map(x[i], psi);
+      decisionValues(psi, decvs);
+      double label = svm_ovr_decision(decvs, labels, nr_class,
+				      probs ? probs + (size_t) i*nr_class : p, lamda);
+      if(predicted)
+	predicted[i] = label;
+    }
+  }
+}
+
+double svm_predict_ovr_probs(LinearOvrPredictor& predictor, const svm_node* x,
+			     double* probs, double lamda){
+  return predictor.predict(x, probs, lamda);
+}
+
+void svm_predict_ovr_batch(LinearOvrPredictor& predictor, const svm_node* const* x,
+			   int n, double* predicted, double* probs, double lamda){
+  predictor.predictBatch(x, n, predicted, probs, lamda);
+}
+
+/**
+ * \fn LinearOvrPredictor* svm_train_linear_ovr(const svm_problem *prob, const svm_parameter *param, int k, int order)
+ * \brief Trains the linear one-versus-the-rest models of a problem on its
+ * BOWs mapped with the kernel of param (CHIS or INTERS) and the given
+ * order (see LinearOvrPredictor::train).
+ *
+ * \param[in] k The dimension of the BOWs.
+ * \param[in] order The order of the feature map (> 0).
+ * \return The models, in the order of get_labels_from_prob (to be deleted).
+ */
+LinearOvrPredictor* svm_train_linear_ovr(const svm_problem *prob,
+					 const svm_parameter *param, int k,
+					 int order){
+  LinearOvrPredictor* predictor =
+    new LinearOvrPredictor(param->kernel_type, k, order,
+			   get_labels_from_prob(prob));
+  int dim = predictor->getMap().getDim();
+  float* psi = new float[(size_t) prob->l*dim];
+  predictor->getMap().map(prob->x, prob->l, psi);
+  std::vector<int> rows(prob->l);
+  for(int i=0 ; i<prob->l ; i++)
+    rows[i] = i;
+  double* alpha = new double[(size_t) prob->l*predictor->getNrClass()];
+  for(size_t i=0 ; i<(size_t) prob->l*predictor->getNrClass() ; i++)
+    alpha[i] = 0;
+  predictor->train(psi, rows, prob->y, *param, alpha);
+  delete[] alpha;
+  delete[] psi;
+  return predictor;
+}
+
+/**
+ * \fn void svm_compare_linear(OvrPredictor& exact, LinearOvrPredictor& approx, const struct svm_problem& svmProblem)
+ * \brief Prints the accuracies of the kernel models and of their linear
+ * approximation on a problem, how often they agree, the largest error on
+ * the decision values and the prediction times.
+ */
+void svm_compare_linear(OvrPredictor& exact,
+			LinearOvrPredictor& approx,
+			const struct svm_problem& svmProblem){
+  int nr_class = exact.getNrClass();
+  double* decvs = new double[nr_class];
+  double* approxDecvs = new double[nr_class];
+  double* probs = new double[nr_class];
+  int exactCorrect = 0, approxCorrect = 0, agree = 0;
+  double maxError = 0, exactTime = 0, approxTime = 0;
+  for(int i=0 ; i<svmProblem.l ; i++){
+    double start = omp_get_wtime();
+    double exactLabel = exact.predict(svmProblem.x[i], probs, 2);
+    double middle = omp_get_wtime();
+    double approxLabel = approx.predict(svmProblem.x[i], probs, 2);
+    approxTime += omp_get_wtime() - middle;
+    exactTime += middle - start;
+    exactCorrect += (exactLabel == svmProblem.y[i]);
+    approxCorrect += (approxLabel == svmProblem.y[i]);
+    agree += (exactLabel == approxLabel);
+    exact.decisionValues(svmProblem.x[i], decvs);
+    approx.decisionValues(svmProblem.x[i], approxDecvs);
+    for(int c=0 ; c<nr_class ; c++)
+      if(fabs(decvs[c] - approxDecvs[c]) > maxError)
+	maxError = fabs(decvs[c] - approxDecvs[c]);
+  }
+  int l = svmProblem.l > 0 ? svmProblem.l : 1;
+  std::cout << "Kernel models: " << 100.*exactCorrect/l << "% ("
+	    << exactTime*1e6/l << " us/BOW), linear models (order "
+	    << approx.getMap().getOrder() << "): " << 100.*approxCorrect/l << "% ("
+	    << approxTime*1e6/l << " us/BOW), same label for "
+	    << 100.*agree/l << "%, largest decision value error "
+	    << maxError << std::endl;
+  delete[] decvs;
+  delete[] approxDecvs;
+  delete[] probs;
+}
+
 //print ovr label:prob
 void svm_ovr_print(double *labels, double *probs, int nbr_class){
   using namespace std;
@@ -1054,6 +1932,10 @@ void get_svm_parameter(int k,struct svm_parameter &svmParameter){
   
   svmParameter.shrinking = 1;	/* use the shrinking heuristics */
   svmParameter.probability = 0; /* do probability estimates */
+  
+  // The kernel columns of at least SVM_PARALLEL_FILL values are filled by
+  // several threads (if the training is not itself in a parallel region)
+  svmParameter.parallel_fill = SVM_PARALLEL_FILL;
 }
 
 std::vector<double> get_labels_from_prob(const svm_problem *prob){
@@ -1074,3 +1956,141 @@ std::vector<double> get_labels_from_prob(const svm_problem *prob){
   }
   return labels;
 }
+
+/**
+ * \fn bool svm_kernel_uses_gamma(int kernel_type)
+ * \brief Tells if the kernel depends on the gamma parameter (the chi-square
+ * and the intersection kernels do not, RBFCHIS uses A).
+ */
+bool svm_kernel_uses_gamma(int kernel_type){
+  return kernel_type == POLY || kernel_type == RBF || kernel_type == SIGMOID;
+}
+
+/**
+ * \fn double svm_kernel_base(const svm_node* x, const svm_node* y, const struct svm_parameter& param)
+ * \brief Computes the part of the kernel value which does not depend on
+ * gamma: the dot product (LINEAR, POLY, SIGMOID), the squared distance
+ * (RBF) or the kernel value itself (CHIS, RBFCHIS, INTERS), as libsvm
+ * computes it (svm_k_base).
+ */
+double svm_kernel_base(const svm_node* x, const svm_node* y,
+		       const struct svm_parameter& param){
+  return svm_k_base(x, y, &param);
+}
+
+/**
+ * \fn double* svm_gram_base(const svm_node* const* x, int n, const struct svm_parameter& param)
+ * \brief Computes the gamma independent part of the Gram matrix of n
+ * vectors (see svm_kernel_base). The rows are computed concurrently.
+ *
+ * \return The n x n symmetric matrix (row-major, to be deleted[]).
+ */
+double* svm_gram_base(const svm_node* const* x, int n,
+		      const struct svm_parameter& param){
+  double* base = new double[(size_t) n*n];
+#pragma omp parallel for schedule(dynamic,16)
+  for(int i=0 ; i<n ; i++){
+    for(int j=i ; j<n ; j++){
+      double v = svm_kernel_base(x[i], x[j], param);
+      base[(size_t) i*n + j] = v;
+      base[(size_t) j*n + i] = v;
+    }
+  }
+  return base;
+}
+
+/**
+ * \fn void svm_gram_kernel(const double* base, int n, const struct svm_parameter& param, double* gram)
+ * \brief Gives the Gram matrix for the gamma of param from its gamma
+ * independent part (O(n^2), without any kernel evaluation).
+ *
+ * \param[in] base The matrix computed by svm_gram_base.
+ * \param[in] n Its size.
+ * \param[in] param The parameters of the kernel.
+ * \param[out] gram The n x n Gram matrix (may be base).
+ */
+void svm_gram_kernel(const double* base, int n,
+		     const struct svm_parameter& param, double* gram){
+  size_t size = (size_t) n*n;
+  for(size_t i=0 ; i<size ; i++){
+    double v = base[i];
+    switch(param.kernel_type){
+    case POLY:
+      v = pow(param.gamma*v + param.coef0, param.degree);
+      break;
+    case RBF:
+      v = exp(-param.gamma*v);
+      break;
+    case SIGMOID:
+      v = tanh(param.gamma*v + param.coef0);
+      break;
+    }
+    gram[i] = v;
+  }
+}
+
+/**
+ * \fn struct svm_node* svm_precomputed_row(const double* gram, int n, int row, const std::vector<int>& cols)
+ * \brief Gives a vector in the PRECOMPUTED format of libsvm: the node j
+ * (j >= 1) is its kernel value with the j-th training vector.
+ *
+ * \param[in] gram The Gram matrix of all the vectors (n x n).
+ * \param[in] n Its size.
+ * \param[in] row The index of the vector in the Gram matrix.
+ * \param[in] cols The indices of the training vectors in the Gram matrix.
+ * \return The nodes (to be freed).
+ */
+struct svm_node* svm_precomputed_row(const double* gram, int n, int row,
+				     const std::vector<int>& cols){
+  int l = cols.size();
+  struct svm_node* x = (struct svm_node*) malloc((l + 2)*sizeof(struct svm_node));
+  if(x == NULL){
+    std::cerr << "Malloc error of a precomputed row!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const double* g = gram + (size_t) row*n;
+  x[0].index = 0;
+  x[0].value = 0;
+  for(int j=0 ; j<l ; j++){
+    x[j+1].index = j + 1;
+    x[j+1].value = g[cols[j]];
+  }
+  x[l+1].index = -1;
+  return x;
+}
+
+/**
+ * \fn struct svm_problem svm_precomputed_problem(const double* gram, int n, const std::vector<int>& rows, const double* y)
+ * \brief Builds the training problem, in the PRECOMPUTED format of libsvm,
+ * of a subset of the vectors of a Gram matrix. The node 0 of the i-th
+ * vector is its serial number i+1. It has to be trained with the
+ * kernel_type PRECOMPUTED and must not be destroyed (destroy_svm_problem)
+ * before the models (their support vectors point to it).
+ *
+ * \param[in] gram The Gram matrix of all the vectors (n x n).
+ * \param[in] n Its size.
+ * \param[in] rows The indices of the training vectors in the Gram matrix.
+ * \param[in] y The labels of all the vectors.
+ * \return The problem.
+ */
+struct svm_problem svm_precomputed_problem(const double* gram, int n,
+					   const std::vector<int>& rows,
+					   const double* y){
+  int l = rows.size();
+  struct svm_node* nodes = NULL;
+  struct svm_problem svmProblem = alloc_svm_problem(l, (size_t) l*(l + 2), &nodes);
+  for(int i=0 ; i<l ; i++){
+    svmProblem.y[i] = y[rows[i]];
+    struct svm_node* x = nodes + (size_t) i*(l + 2);
+    const double* g = gram + (size_t) rows[i]*n;
+    x[0].index = 0;
+    x[0].value = i + 1;
+    for(int j=0 ; j<l ; j++){
+      x[j+1].index = j + 1;
+      x[j+1].value = g[rows[j]];
+    }
+    x[l+1].index = -1;
+    svmProblem.x[i] = x;
+  }
+  return svmProblem;
+}
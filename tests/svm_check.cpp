@@ -0,0 +1,177 @@
+/**
+ * \file svm_check.cpp
+ * \brief Checks the fast paths of the SVM against the reference ones:
+ * - OvrPredictor and svm_predict_ovr_batch give the predictions of the
+ * models (svm_predict_ovr_probs) for the RBF, CHIS and INTERS kernels,
+ * - the kernel values on the dense rows (CHIS, INTERS) are the sparse ones,
+ * - svm_train_warm along a C path reaches the objective of cold starts,
+ * - SvmProblemBuilder copies the BOWs node for node.
+ *
+ * The BOWs are random (fixed seed). The program returns EXIT_FAILURE if
+ * one of the checks fails.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <vector>
+#include "naosvm.h"
+
+#define NR_CLASS 4
+#define NR_BOW 240
+#define K 64
+
+static int nrFailures = 0;
+
+static void check(bool ok, std::string what){
+  std::cout << (ok ? "ok:     " : "FAILED: ") << what << std::endl;
+  if(!ok)
+    nrFailures++;
+}
+
+// NR_BOW normalized random BOWs of K bins (about 1/3 of them empty), the
+// bins of the class being a bit higher
+static struct svm_problem random_problem(){
+  SvmProblemBuilder builder;
+  float histogram[K];
+  for(int i=0 ; i<NR_BOW ; i++){
+    int label = i%NR_CLASS + 1;
+    double sum = 0;
+    for(int d=0 ; d<K ; d++){
+      histogram[d] = (rand()%3 == 0) ? 0 : (float) rand()/RAND_MAX;
+      if(d%NR_CLASS == label - 1)
+	histogram[d] *= 1.5;
+      sum += histogram[d];
+    }
+    for(int d=0 ; d<K ; d++)
+      histogram[d] /= sum;
+    builder.addBOW(histogram, K, label);
+  }
+  return builder.build();
+}
+
+// The dual objective 1/2.sum_ij coef_i.coef_j.K(sv_i,sv_j) - sum_i |coef_i|
+static double dual_objective(const struct svm_model* model){
+  double objective = 0;
+  for(int i=0 ; i<model->l ; i++){
+    double coef_i = model->sv_coef[0][i];
+    for(int j=0 ; j<model->l ; j++)
+      objective += 0.5*coef_i*model->sv_coef[0][j]*
+	svm_k_function(model->SV[i], model->SV[j], &model->param);
+    objective -= fabs(coef_i);
+  }
+  return objective;
+}
+
+// OvrPredictor (predict and svm_predict_ovr_batch) against the models
+static void check_ovr_predictor(const struct svm_problem& prob, int kernel_type,
+				std::string name){
+  struct svm_parameter param;
+  get_svm_parameter(K, param);
+  param.kernel_type = kernel_type;
+  param.C = 8;
+  struct svm_model** models = svm_train_ovr(&prob, &param);
+  OvrPredictor predictor(models, NR_CLASS);
+  std::vector<double> batchLabels(prob.l), batchProbs(prob.l*NR_CLASS);
+  svm_predict_ovr_batch(predictor, prob.x, prob.l,
+			&batchLabels[0], &batchProbs[0], 2);
+  double probs[NR_CLASS], predictorProbs[NR_CLASS];
+  bool sameLabels = true;
+  double maxError = 0;
+  for(int i=0 ; i<prob.l ; i++){
+    double label = svm_predict_ovr_probs(models, prob.x[i], NR_CLASS, probs, 2);
+    double predictorLabel = svm_predict_ovr_probs(predictor, prob.x[i],
+						  predictorProbs, 2);
+    sameLabels = sameLabels && label == predictorLabel && label == batchLabels[i];
+    for(int c=0 ; c<NR_CLASS ; c++){
+      maxError = std::max(maxError, fabs(probs[c] - predictorProbs[c]));
+      maxError = std::max(maxError, fabs(probs[c] - batchProbs[i*NR_CLASS + c]));
+    }
+  }
+  check(sameLabels && maxError < 1e-6,
+	"OvrPredictor and svm_predict_ovr_batch predict as the " + name + " models");
+  for(int c=0 ; c<NR_CLASS ; c++)
+    svm_free_and_destroy_model(&models[c]);
+  delete[] models;
+}
+
+// The kernel values on the dense rows of the SVs against svm_k_function
+static void check_dense_kernel(const struct svm_problem& prob, int kernel_type,
+			       std::string name){
+  struct svm_model model;
+  get_svm_parameter(K, model.param);
+  model.param.kernel_type = kernel_type;
+  model.l = prob.l;
+  model.SV = prob.x;
+  svm_build_dense_sv(&model);
+  bool dense = (model.SV_dense != NULL);
+  std::vector<double> kvalue(prob.l);
+  double maxError = 0;
+  for(int i=0 ; i<prob.l ; i++){
+    svm_kernel_values(&model, prob.x[i], &kvalue[0], NULL);
+    for(int j=0 ; j<prob.l ; j++)
+      maxError = std::max(maxError, fabs(kvalue[j] - svm_k_function(prob.x[i], prob.x[j],
+								    &model.param)));
+  }
+  check(dense && maxError < 1e-5,
+	"the dense " + name + " kernel values are the sparse ones");
+  free(model.SV_dense);
+}
+
+// svm_train_warm along increasing C against cold starts
+static void check_warm_start(const struct svm_problem& prob){
+  struct svm_parameter param;
+  get_svm_parameter(K, param);
+  param.eps = 1e-5;
+  std::vector<double> alpha(prob.l, 0), G(prob.l, 0);
+  double maxError = 0;
+  for(int c=-2 ; c<=6 ; c++){
+    param.C = pow(2, c);
+    struct svm_model* warm = svm_train_ovr_class(&prob, &param, 1, &alpha[0], &G[0]);
+    struct svm_model* cold = svm_train_ovr_class(&prob, &param, 1);
+    double coldObjective = dual_objective(cold);
+    maxError = std::max(maxError, fabs(dual_objective(warm) - coldObjective)/
+			(fabs(coldObjective) + 1e-12));
+    svm_free_and_destroy_model(&warm);
+    svm_free_and_destroy_model(&cold);
+  }
+  check(maxError < 1e-4, "svm_train_warm reaches the objective of cold starts along C");
+}
+
+// SvmProblemBuilder against the BOWs it was given
+static void check_problem_builder(const struct svm_problem& prob){
+  SvmProblemBuilder builder;
+  int half = prob.l/2;
+  struct svm_problem first = prob;
+  first.l = half;
+  builder.addProblem(first);
+  for(int i=half ; i<prob.l ; i++)
+    builder.addBOW(prob.x[i], prob.y[i]);
+  struct svm_problem built = builder.build();
+  bool same = (built.l == prob.l);
+  for(int i=0 ; same && i<prob.l ; i++){
+    same = (built.y[i] == prob.y[i]);
+    int j = 0;
+    for( ; same && prob.x[i][j].index != -1 ; j++)
+      same = (built.x[i][j].index == prob.x[i][j].index &&
+	      built.x[i][j].value == prob.x[i][j].value);
+    same = same && built.x[i][j].index == -1;
+  }
+  check(same, "SvmProblemBuilder copies the BOWs node for node");
+  destroy_svm_problem(built);
+}
+
+int main(int argc, char* argv[]){
+  srand(42);
+  struct svm_problem prob = random_problem();
+
+  check_ovr_predictor(prob, RBF, "RBF");
+  check_ovr_predictor(prob, CHIS, "CHIS");
+  check_ovr_predictor(prob, INTERS, "INTERS");
+  check_dense_kernel(prob, CHIS, "CHIS");
+  check_dense_kernel(prob, INTERS, "INTERS");
+  check_warm_start(prob);
+  check_problem_builder(prob);
+
+  destroy_svm_problem(prob);
+  return (nrFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}